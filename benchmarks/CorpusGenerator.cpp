@@ -0,0 +1,261 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "CorpusGenerator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Common words, most frequent first. Other vocabularies, i.e. from
+// frequency lists, can be supplied through CorpusGenerator::setVocabulary.
+static const char* const en_words[] = {
+	"the", "of", "and", "to", "a", "in", "is", "you", "that", "it", "he", "was", "for", "on", "are",
+	"as", "with", "his", "they", "I", "at", "be", "this", "have", "from", "or", "one", "had", "by",
+	"word", "but", "not", "what", "all", "were", "we", "when", "your", "can", "said", "there", "use",
+	"an", "each", "which", "she", "do", "how", "their", "if", "will", "up", "other", "about", "out",
+	"many", "then", "them", "these", "so", "some", "her", "would", "make", "like", "him", "into",
+	"time", "has", "look", "two", "more", "write", "go", "see", "number", "no", "way", "could",
+	"people", "my", "than", "first", "water", "been", "call", "who", "its", "now", "find", "long",
+	"down", "day", "did", "get", "come", "made", "may", "part", "over", "new", "sound", "take",
+	"only", "little", "work", "know", "place", "year", "live", "back", "give", "most", "very",
+	"after", "thing", "just", "name", "good", "sentence", "man", "think", "say", "great", "where",
+	"help", "through", "much", "before", "line", "right", "too", "mean", "old", "any", "same",
+	"tell", "boy", "follow", "came", "want", "show", "also", "around", "form", "three", "small",
+	"set", "put", "end", "does", "another", "well", "large", "must", "big", "even", "such",
+	"because", "turn", "here", "why", "ask", "went", "men", "read", "need", "land", "different",
+	"home", "us", "move", "try", "kind", "hand", "picture", "again", "change", "off", "play",
+	"spell", "air", "away", "animal", "house", "point", "page", "letter", "mother", "answer",
+	"found", "study", "still", "learn", "should", "world", "high", "every", "near", "add", "food",
+	"between", "own", "below", "country", "plant", "last", "school", "father", "keep", "tree",
+	"never", "start", "city", "earth", "eye", "light", "thought", "head", "under", "story"
+};
+static const char* const en_contractions[] = {
+	"don't", "it's", "can't", "isn't", "I'm", "you're", "won't", "didn't", "that's", "there's",
+	"we've", "they'll", "wouldn't", "doesn't", "let's", "I'd", "she's", "aren't", "couldn't"
+};
+static const char* const de_words[] = {
+	"der", "die", "und", "in", "den", "von", "zu", "das", "mit", "sich", "des", "auf", "für", "ist",
+	"im", "dem", "nicht", "ein", "eine", "als", "auch", "es", "an", "werden", "aus", "er", "hat",
+	"dass", "sie", "nach", "wird", "bei", "einer", "um", "am", "sind", "noch", "wie", "einem",
+	"über", "einen", "so", "zum", "war", "haben", "nur", "oder", "aber", "vor", "zur", "bis",
+	"mehr", "durch", "man", "sein", "wurde", "sei", "hatte", "kann", "gegen", "vom", "können",
+	"schon", "wenn", "habe", "seine", "Jahr", "ihre", "dann", "unter", "wir", "soll", "ich",
+	"eines", "zwei", "Jahren", "diese", "dieser", "wieder", "keine", "seiner", "worden", "Zeit",
+	"Stadt", "Haus", "Menschen", "Welt", "Land", "Arbeit", "Frage", "gut", "groß", "neue", "immer",
+	"heute", "hier", "viele", "Kinder", "Schule", "Straße", "Wasser", "sehr", "ohne", "zwischen"
+};
+static const char* const de_contractions[] = {
+	"geht's", "gibt's", "wie's", "hab's", "ist's", "war's"
+};
+static const char* const fr_words[] = {
+	"de", "la", "le", "et", "les", "des", "en", "un", "du", "une", "que", "est", "pour", "qui",
+	"dans", "a", "par", "plus", "pas", "au", "sur", "ne", "se", "ce", "il", "sont", "avec", "ou",
+	"son", "aux", "on", "mais", "nous", "comme", "été", "leur", "elle", "cette", "ses", "ont",
+	"tout", "vous", "y", "peut", "deux", "fait", "entre", "aussi", "très", "sans", "bien", "même",
+	"temps", "ans", "premier", "homme", "monde", "pays", "travail", "jour", "vie", "ville",
+	"maison", "école", "enfant", "femme", "année", "nouveau", "grand", "petit", "toujours",
+	"encore", "depuis", "avant", "après", "quand", "où", "beaucoup", "chose", "place", "eau"
+};
+static const char* const fr_contractions[] = {
+	"c'est", "j'ai", "l'homme", "d'accord", "qu'il", "n'est", "l'école", "d'un", "s'il", "jusqu'à"
+};
+
+template<int N>
+static QStringList to_string_list(const char* const (&words)[N])
+{
+	QStringList list;
+	list.reserve(N);
+	for(int i = 0; i < N; ++i){
+		list.append(QString::fromUtf8(words[i]));
+	}
+	return list;
+}
+
+namespace QtSpell {
+
+CorpusGenerator::CorpusGenerator(const CorpusOptions& options)
+	: m_options(options)
+{
+	setVocabulary("en_US", to_string_list(en_words), to_string_list(en_contractions));
+	setVocabulary("de_DE", to_string_list(de_words), to_string_list(de_contractions));
+	setVocabulary("fr_FR", to_string_list(fr_words), to_string_list(fr_contractions));
+}
+
+QStringList CorpusGenerator::builtinLanguages()
+{
+	return QStringList() << "en_US" << "de_DE" << "fr_FR";
+}
+
+void CorpusGenerator::setVocabulary(const QString& lang, const QStringList& wordsByFrequency, const QStringList& contractions)
+{
+	Vocabulary& vocabulary = m_vocabularies[lang];
+	vocabulary.words = wordsByFrequency;
+	vocabulary.words.removeAll(QString());
+	vocabulary.contractions = contractions;
+	buildCdf(vocabulary);
+}
+
+void CorpusGenerator::buildCdf(Vocabulary& vocabulary) const
+{
+	int n = vocabulary.words.size();
+	if(m_options.vocabularySize > 0){
+		n = qMin(n, m_options.vocabularySize);
+	}
+	vocabulary.cdf.resize(n);
+	double sum = 0.;
+	for(int rank = 0; rank < n; ++rank){
+		sum += 1. / std::pow(rank + 1., m_options.zipfExponent);
+		vocabulary.cdf[rank] = sum;
+	}
+	for(int rank = 0; rank < n; ++rank){
+		vocabulary.cdf[rank] /= sum;
+	}
+}
+
+QString CorpusGenerator::generate()
+{
+	m_state = m_options.seed;
+	m_wordCount = 0;
+	m_typoCount = 0;
+
+	QString text;
+	text.reserve(m_options.size + 256);
+	while(text.size() < m_options.size){
+		const Vocabulary& vocabulary = pickVocabulary();
+		if(vocabulary.cdf.isEmpty()){
+			break;
+		}
+		int sentences = uniformInt(m_options.paragraphMin, m_options.paragraphMax);
+		for(int sentence = 0; sentence < sentences; ++sentence){
+			int words = uniformInt(m_options.sentenceMin, m_options.sentenceMax);
+			for(int i = 0; i < words; ++i){
+				QString word;
+				if(!vocabulary.contractions.isEmpty() && uniform() < m_options.apostropheRate){
+					word = vocabulary.contractions[uniformInt(0, vocabulary.contractions.size() - 1)];
+				}else{
+					word = pickWord(vocabulary);
+					if(uniform() < m_options.typoRate){
+						word = misspell(word);
+						++m_typoCount;
+					}
+				}
+				if(i == 0){
+					word[0] = word.at(0).toUpper();
+				}
+				if(uniform() < m_options.markupRate){
+					word = markup(word);
+				}
+				if(i > 0){
+					text += ' ';
+				}
+				text += word;
+				++m_wordCount;
+			}
+			text += sentence + 1 < sentences ? ". " : ".";
+		}
+		text += '\n';
+	}
+	return text;
+}
+
+quint64 CorpusGenerator::nextRandom()
+{
+	// SplitMix64, identical output on all platforms
+	quint64 z = (m_state += Q_UINT64_C(0x9E3779B97F4A7C15));
+	z = (z ^ (z >> 30)) * Q_UINT64_C(0xBF58476D1CE4E5B9);
+	z = (z ^ (z >> 27)) * Q_UINT64_C(0x94D049BB133111EB);
+	return z ^ (z >> 31);
+}
+
+double CorpusGenerator::uniform()
+{
+	return (nextRandom() >> 11) * (1. / 9007199254740992.);
+}
+
+int CorpusGenerator::uniformInt(int min, int max)
+{
+	if(max <= min){
+		return min;
+	}
+	return min + int(nextRandom() % quint64(max - min + 1));
+}
+
+const CorpusGenerator::Vocabulary& CorpusGenerator::pickVocabulary()
+{
+	double total = 0.;
+	for(const QPair<QString, double>& language : m_options.languages){
+		if(m_vocabularies.contains(language.first)){
+			total += language.second;
+		}
+	}
+	double pick = uniform() * total;
+	for(const QPair<QString, double>& language : m_options.languages){
+		if(!m_vocabularies.contains(language.first)){
+			continue;
+		}
+		pick -= language.second;
+		if(pick < 0.){
+			return m_vocabularies[language.first];
+		}
+	}
+	return m_vocabularies["en_US"];
+}
+
+QString CorpusGenerator::pickWord(const Vocabulary& vocabulary)
+{
+	double u = uniform();
+	int rank = int(std::lower_bound(vocabulary.cdf.begin(), vocabulary.cdf.end(), u) - vocabulary.cdf.begin());
+	return vocabulary.words[qMin(rank, vocabulary.cdf.size() - 1)];
+}
+
+QString CorpusGenerator::misspell(const QString& word)
+{
+	QString typo = word;
+	QChar letter = QChar('a' + uniformInt(0, 25));
+	int pos = uniformInt(0, typo.length() - 1);
+	switch(typo.length() < 3 ? 2 : uniformInt(0, 3)){
+	case 0: // Transposition
+		pos = qMin(pos, typo.length() - 2);
+		typo[pos] = word.at(pos + 1);
+		typo[pos + 1] = word.at(pos);
+		break;
+	case 1: // Deletion
+		typo.remove(pos, 1);
+		break;
+	case 2: // Insertion
+		typo.insert(pos, letter);
+		break;
+	default: // Substitution
+		typo[pos] = letter;
+		break;
+	}
+	if(typo == word){
+		typo.insert(pos, letter);
+	}
+	return typo;
+}
+
+QString CorpusGenerator::markup(const QString& word)
+{
+	static const char* const templates[] = {
+		"<b>%1</b>", "<i>%1</i>", "*%1*", "_%1_", "<a href=\"https://example.org/%1\">%1</a>"
+	};
+	return QString(templates[uniformInt(0, 4)]).arg(word);
+}
+
+} // QtSpell
@@ -0,0 +1,125 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef QTSPELL_CORPUSGENERATOR_HPP
+#define QTSPELL_CORPUSGENERATOR_HPP
+
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace QtSpell {
+
+/**
+ * @brief Parameters of a synthetic corpus, see QtSpell::CorpusGenerator.
+ */
+struct CorpusOptions
+{
+	/** @brief The seed, equal seeds and options produce equal documents. */
+	quint64 seed = 1;
+	/** @brief The approximate document size in characters. */
+	int size = 1024 * 1024;
+	/** @brief The exponent of the Zipfian word frequency distribution. */
+	double zipfExponent = 1.0;
+	/** @brief The number of most frequent vocabulary words to use, 0 for all. */
+	int vocabularySize = 0;
+	/** @brief The probability of a word being misspelled. */
+	double typoRate = 0.02;
+	/** @brief The probability of a word being replaced by a contraction or possessive. */
+	double apostropheRate = 0.03;
+	/** @brief The probability of a word being wrapped in markup. */
+	double markupRate = 0.0;
+	/** @brief The minimum and maximum number of words per sentence. */
+	int sentenceMin = 4, sentenceMax = 20;
+	/** @brief The minimum and maximum number of sentences per paragraph. */
+	int paragraphMin = 1, paragraphMax = 8;
+	/** @brief The languages and their relative weights, picked per paragraph. */
+	QList<QPair<QString, double>> languages = {qMakePair(QString("en_US"), 1.0)};
+};
+
+/**
+ * @brief Generates deterministic synthetic documents for benchmarks and tests.
+ * @details Words are drawn from per-language vocabularies ordered by
+ *          frequency, following a Zipfian distribution. Typos, contractions
+ *          and markup are injected at configurable rates. The generator uses
+ *          its own pseudo random number generator, so that a seed produces
+ *          the same document on every platform and Qt version.
+ */
+class CorpusGenerator
+{
+public:
+	CorpusGenerator(const CorpusOptions& options = CorpusOptions());
+
+	/**
+	 * @brief Replace the vocabulary of a language.
+	 * @param lang The language, as a locale specifier.
+	 * @param wordsByFrequency The words, most frequent first.
+	 * @param contractions Words containing apostrophes, i.e. "don't".
+	 */
+	void setVocabulary(const QString& lang, const QStringList& wordsByFrequency, const QStringList& contractions = QStringList());
+
+	/**
+	 * @brief Generate a document.
+	 * @return The generated text, paragraphs are separated by newlines.
+	 */
+	QString generate();
+
+	/**
+	 * @brief Returns the number of words in the last generated document.
+	 */
+	int wordCount() const{ return m_wordCount; }
+
+	/**
+	 * @brief Returns the number of injected misspellings in the last generated document.
+	 */
+	int typoCount() const{ return m_typoCount; }
+
+	/**
+	 * @brief Returns the languages with a built-in vocabulary.
+	 */
+	static QStringList builtinLanguages();
+
+private:
+	struct Vocabulary {
+		QStringList words;
+		QStringList contractions;
+		QVector<double> cdf;
+	};
+
+	CorpusOptions m_options;
+	QMap<QString, Vocabulary> m_vocabularies;
+	quint64 m_state = 0;
+	int m_wordCount = 0;
+	int m_typoCount = 0;
+
+	quint64 nextRandom();
+	double uniform();
+	int uniformInt(int min, int max);
+	const Vocabulary& pickVocabulary();
+	QString pickWord(const Vocabulary& vocabulary);
+	QString misspell(const QString& word);
+	QString markup(const QString& word);
+	void buildCdf(Vocabulary& vocabulary) const;
+};
+
+} // QtSpell
+
+#endif // QTSPELL_CORPUSGENERATOR_HPP
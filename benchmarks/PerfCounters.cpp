@@ -0,0 +1,139 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "PerfCounters.hpp"
+
+#ifdef __linux__
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace QtSpell {
+
+#ifdef __linux__
+static int perf_event_open(perf_event_attr* attr)
+{
+	// Calling thread, any CPU, no group
+	return int(syscall(__NR_perf_event_open, attr, 0, -1, -1, 0));
+}
+
+static const quint64 s_eventConfigs[] = {
+	PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_CACHE_MISSES,
+	PERF_COUNT_HW_BRANCH_MISSES
+};
+#endif
+
+PerfCounters::PerfCounters()
+{
+	for(int i = 0; i < CounterCount; ++i){
+		m_fds[i] = -1;
+		m_values[i] = 0;
+	}
+#ifdef __linux__
+	for(int i = 0; i < CounterCount; ++i){
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = s_eventConfigs[i];
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		m_fds[i] = perf_event_open(&attr);
+		if(m_fds[i] < 0){
+			m_errorString += QString("%1: %2\n").arg(name(Counter(i))).arg(strerror(errno));
+		}
+	}
+#else
+	m_errorString = "Hardware performance counters are only supported on Linux\n";
+#endif
+	m_errorString = m_errorString.trimmed();
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+	for(int fd : m_fds){
+		if(fd >= 0){
+			close(fd);
+		}
+	}
+#endif
+}
+
+bool PerfCounters::isAvailable() const
+{
+	for(int fd : m_fds){
+		if(fd >= 0){
+			return true;
+		}
+	}
+	return false;
+}
+
+void PerfCounters::start()
+{
+#ifdef __linux__
+	for(int fd : m_fds){
+		if(fd >= 0){
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+#endif
+}
+
+void PerfCounters::stop()
+{
+#ifdef __linux__
+	for(int fd : m_fds){
+		if(fd >= 0){
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+		}
+	}
+	for(int i = 0; i < CounterCount; ++i){
+		m_values[i] = 0;
+		// value, time enabled, time running
+		quint64 data[3];
+		if(m_fds[i] >= 0 && read(m_fds[i], data, sizeof(data)) == ssize_t(sizeof(data))){
+			if(data[2] > 0 && data[2] < data[1]){
+				// Counter was multiplexed, extrapolate
+				m_values[i] = quint64(double(data[0]) * data[1] / data[2]);
+			}else{
+				m_values[i] = data[0];
+			}
+		}
+	}
+#endif
+}
+
+const char* PerfCounters::name(Counter counter)
+{
+	static const char* const names[] = {"instructions", "cycles", "cache-misses", "branch-misses"};
+	return names[counter];
+}
+
+} // QtSpell
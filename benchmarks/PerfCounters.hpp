@@ -0,0 +1,89 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef QTSPELL_PERFCOUNTERS_HPP
+#define QTSPELL_PERFCOUNTERS_HPP
+
+#include <QString>
+
+namespace QtSpell {
+
+/**
+ * @brief Hardware performance counters of the calling thread.
+ * @details Uses perf_event_open on Linux. Counters which cannot be opened,
+ *          i.e. due to kernel.perf_event_paranoid, missing PMU support in
+ *          virtual machines or on other platforms, are reported as
+ *          unavailable and the remaining ones keep working.
+ */
+class PerfCounters
+{
+public:
+	enum Counter { Instructions, Cycles, CacheMisses, BranchMisses, CounterCount };
+
+	PerfCounters();
+	~PerfCounters();
+
+	/**
+	 * @brief Returns whether at least one counter is available.
+	 */
+	bool isAvailable() const;
+
+	/**
+	 * @brief Returns whether the specified counter is available.
+	 */
+	bool isAvailable(Counter counter) const{ return m_fds[counter] >= 0; }
+
+	/**
+	 * @brief Returns why counters are unavailable, empty if all are available.
+	 */
+	const QString& errorString() const{ return m_errorString; }
+
+	/**
+	 * @brief Reset and start counting.
+	 */
+	void start();
+
+	/**
+	 * @brief Stop counting and read the counter values.
+	 */
+	void stop();
+
+	/**
+	 * @brief Returns the value of a counter between the last start and stop,
+	 *        scaled up if the kernel multiplexed the counter, 0 if unavailable.
+	 */
+	quint64 value(Counter counter) const{ return m_values[counter]; }
+
+	/**
+	 * @brief Returns the display name of a counter.
+	 */
+	static const char* name(Counter counter);
+
+private:
+	int m_fds[CounterCount];
+	quint64 m_values[CounterCount];
+	QString m_errorString;
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+};
+
+} // QtSpell
+
+#endif // QTSPELL_PERFCOUNTERS_HPP
@@ -0,0 +1,212 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "CorpusGenerator.hpp"
+#include "PerfCounters.hpp"
+#include "QtSpell.hpp"
+#include "Tokenizer.hpp"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QPlainTextEdit>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <algorithm>
+#include <functional>
+
+// Runs the checking pipeline benchmark cases, reporting the median wall time
+// and, where available, the hardware performance counters per repetition.
+
+struct BenchCase {
+	const char* name;
+	const char* description;
+	std::function<void()> setup;
+	std::function<void()> run;
+};
+
+int main(int argc, char* argv[])
+{
+	if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")){
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	}
+	QApplication app(argc, argv);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Benchmarks the QtSpell checking pipeline.");
+	parser.addHelpOption();
+	parser.addOptions({
+		{"size", "Document size in characters.", "chars", "1048576"},
+		{"repeat", "Number of measured repetitions per case.", "n", "5"},
+		{"language", "Dictionary to check against.", "lang", "en_US"},
+		{"filter", "Only run cases whose name contains the string.", "text"},
+		{"list", "List the cases and what they measure, without running them."},
+		{"no-counters", "Don't collect hardware performance counters."}
+	});
+	parser.process(app);
+
+	QtSpell::CorpusOptions options;
+	options.size = parser.value("size").toInt();
+	QString text = QtSpell::CorpusGenerator(options).generate();
+	QStringList words = text.split(QRegularExpression("\\W+"), QString::SkipEmptyParts);
+	int repeat = qMax(1, parser.value("repeat").toInt());
+
+	QPlainTextEdit textEdit;
+	textEdit.setPlainText(text);
+	QtSpell::TextEditChecker checker;
+	if(!checker.setLanguage(parser.value("language"))){
+		QTextStream(stderr) << "Failed to load dictionary for " << parser.value("language") << "\n";
+		return 1;
+	}
+	checker.setTextEdit(&textEdit);
+
+	quint64 editState = 1;
+	QByteArray utf8 = text.toUtf8();
+	quint64 wordChars = 0;
+	QString language = parser.value("language");
+	QList<QPlainTextEdit*> messages;
+	auto clearMessages = [&]{ qDeleteAll(messages); messages.clear(); };
+	QList<BenchCase> cases = {
+		{"check-cold", "full document check with empty caches",
+			[&]{ checker.trimCaches(0); },
+			[&]{ checker.checkSpelling(); }},
+		{"check-warm", "full document check with warm caches",
+			[&]{ checker.checkSpelling(); },
+			[&]{ checker.checkSpelling(); }},
+		{"lookup-cold", "checkWord for every word with empty caches",
+			[&]{ checker.trimCaches(0); },
+			[&]{ for(const QString& word : words){ checker.checkWord(word); } }},
+		{"lookup-warm", "checkWord for every word with warm caches",
+			[&]{ for(const QString& word : words){ checker.checkWord(word); } },
+			[&]{ for(const QString& word : words){ checker.checkWord(word); } }},
+		{"tokenize-utf16", "split the document into words",
+			[&]{ wordChars = 0; },
+			[&]{
+				QtSpell::Tokenizer<> tokenizer(text);
+				for(int start, end; tokenizer.next(&start, &end);){ wordChars += end - start; }
+			}},
+		{"tokenize-utf8", "split the UTF-8 encoded document into words",
+			[&]{ wordChars = 0; },
+			[&]{
+				QtSpell::Tokenizer<QtSpell::UnicodeWordChars, QtSpell::ApostropheJoiners, QtSpell::Utf8View> tokenizer(utf8);
+				for(int start, end; tokenizer.next(&start, &end);){ wordChars += end - start; }
+			}},
+		{"construct", "construction and destruction of 1000 checkers",
+			[&]{},
+			[&]{
+				for(int i = 0; i < 1000; ++i){
+					QtSpell::TextEditChecker shortLived;
+					shortLived.setLanguage(language);
+				}
+			}},
+		{"churn", "1000 checkers attached to and detached from short messages",
+			[&]{
+				clearMessages();
+				for(int i = 0; i < 1000; ++i){
+					messages.append(new QPlainTextEdit(QString("Message %1 with a tpyo in it").arg(i)));
+				}
+			},
+			[&]{
+				for(QPlainTextEdit* message : messages){
+					QtSpell::TextEditChecker shortLived;
+					shortLived.setLanguage(language);
+					shortLived.setTextEdit(message);
+				}
+			}},
+		{"keystrokes", "1000 single character insertions at random positions",
+			[&]{ editState = 1; },
+			[&]{
+				QTextDocument* document = textEdit.document();
+				for(int i = 0; i < 1000; ++i){
+					editState = editState * 6364136223846793005ULL + 1442695040888963407ULL;
+					QTextCursor cursor(document);
+					cursor.setPosition(int((editState >> 33) % quint64(document->characterCount())));
+					cursor.insertText(i % 5 ? "e" : " ");
+				}
+			}}
+	};
+
+	if(parser.isSet("list")){
+		QTextStream out(stdout);
+		for(const BenchCase& benchCase : cases){
+			if(!parser.isSet("filter") || QString(benchCase.name).contains(parser.value("filter"))){
+				out << qSetFieldWidth(16) << left << benchCase.name << qSetFieldWidth(0) << benchCase.description << "\n";
+			}
+		}
+		clearMessages();
+		return 0;
+	}
+
+	QtSpell::PerfCounters counters;
+	bool useCounters = !parser.isSet("no-counters") && counters.isAvailable();
+	if(!parser.isSet("no-counters") && !counters.errorString().isEmpty()){
+		QTextStream(stderr) << "Some performance counters are unavailable:\n" << counters.errorString() << "\n";
+	}
+
+	QTextStream out(stdout);
+	out << "case,median_ms";
+	if(useCounters){
+		for(int i = 0; i < QtSpell::PerfCounters::CounterCount; ++i){
+			out << "," << QtSpell::PerfCounters::name(QtSpell::PerfCounters::Counter(i));
+		}
+		out << ",ipc,cache_misses_per_kinstr,branch_misses_per_kinstr";
+	}
+	out << "\n";
+
+	for(const BenchCase& benchCase : cases){
+		if(parser.isSet("filter") && !QString(benchCase.name).contains(parser.value("filter"))){
+			continue;
+		}
+		QVector<double> times;
+		quint64 totals[QtSpell::PerfCounters::CounterCount] = {};
+		for(int i = 0; i < repeat; ++i){
+			benchCase.setup();
+			QElapsedTimer timer;
+			if(useCounters){
+				counters.start();
+			}
+			timer.start();
+			benchCase.run();
+			qint64 nsecs = timer.nsecsElapsed();
+			if(useCounters){
+				counters.stop();
+				for(int j = 0; j < QtSpell::PerfCounters::CounterCount; ++j){
+					totals[j] += counters.value(QtSpell::PerfCounters::Counter(j));
+				}
+			}
+			times.append(nsecs / 1e6);
+		}
+		std::sort(times.begin(), times.end());
+		out << benchCase.name << "," << times[times.size() / 2];
+		if(useCounters){
+			for(quint64 total : totals){
+				out << "," << total / repeat;
+			}
+			double instructions = double(totals[QtSpell::PerfCounters::Instructions]);
+			auto ratio = [](double num, double den){ return den > 0 ? QString::number(num / den, 'f', 3) : QString("n/a"); };
+			out << "," << ratio(instructions, totals[QtSpell::PerfCounters::Cycles])
+				<< "," << ratio(totals[QtSpell::PerfCounters::CacheMisses] * 1000., instructions)
+				<< "," << ratio(totals[QtSpell::PerfCounters::BranchMisses] * 1000., instructions);
+		}
+		out << "\n";
+		out.flush();
+	}
+	clearMessages();
+	return 0;
+}
@@ -0,0 +1,110 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "CorpusGenerator.hpp"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+
+static QStringList read_word_list(const QString& filename)
+{
+	QStringList words;
+	QFile file(filename);
+	if(file.open(QIODevice::ReadOnly)){
+		QTextStream stream(&file);
+		stream.setCodec("UTF-8");
+		while(!stream.atEnd()){
+			QString word = stream.readLine().trimmed();
+			if(!word.isEmpty()){
+				words.append(word);
+			}
+		}
+	}
+	return words;
+}
+
+int main(int argc, char* argv[])
+{
+	QCoreApplication app(argc, argv);
+	QtSpell::CorpusOptions options;
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Generates deterministic synthetic documents for QtSpell benchmarks.");
+	parser.addHelpOption();
+	parser.addOptions({
+		{"seed", "Random seed.", "n", QString::number(options.seed)},
+		{"size", "Document size in characters.", "chars", QString::number(options.size)},
+		{"zipf", "Exponent of the word frequency distribution.", "s", QString::number(options.zipfExponent)},
+		{"vocabulary-size", "Number of most frequent words to use, 0 for all.", "n", QString::number(options.vocabularySize)},
+		{"vocabulary", "Word list file, one word per line, most frequent first, for the first language.", "file"},
+		{"typo-rate", "Probability of a word being misspelled.", "p", QString::number(options.typoRate)},
+		{"apostrophe-rate", "Probability of a word being a contraction.", "p", QString::number(options.apostropheRate)},
+		{"markup-rate", "Probability of a word being wrapped in markup.", "p", QString::number(options.markupRate)},
+		{"sentence-words", "Minimum and maximum words per sentence.", "min:max", QString("%1:%2").arg(options.sentenceMin).arg(options.sentenceMax)},
+		{"paragraph-sentences", "Minimum and maximum sentences per paragraph.", "min:max", QString("%1:%2").arg(options.paragraphMin).arg(options.paragraphMax)},
+		{"languages", "Languages and weights, i.e. en_US:0.8,de_DE:0.2. Built in: " + QtSpell::CorpusGenerator::builtinLanguages().join(", "), "list", "en_US:1"},
+		{{"o", "output"}, "Output file, standard output if omitted.", "file"}
+	});
+	parser.process(app);
+
+	options.seed = parser.value("seed").toULongLong();
+	options.size = parser.value("size").toInt();
+	options.zipfExponent = parser.value("zipf").toDouble();
+	options.vocabularySize = parser.value("vocabulary-size").toInt();
+	options.typoRate = parser.value("typo-rate").toDouble();
+	options.apostropheRate = parser.value("apostrophe-rate").toDouble();
+	options.markupRate = parser.value("markup-rate").toDouble();
+	QStringList range = parser.value("sentence-words").split(':');
+	options.sentenceMin = range.value(0).toInt();
+	options.sentenceMax = range.value(1, range.value(0)).toInt();
+	range = parser.value("paragraph-sentences").split(':');
+	options.paragraphMin = range.value(0).toInt();
+	options.paragraphMax = range.value(1, range.value(0)).toInt();
+	options.languages.clear();
+	for(const QString& entry : parser.value("languages").split(',', QString::SkipEmptyParts)){
+		QStringList parts = entry.split(':');
+		options.languages.append(qMakePair(parts[0], parts.value(1, "1").toDouble()));
+	}
+
+	QtSpell::CorpusGenerator generator(options);
+	if(parser.isSet("vocabulary") && !options.languages.isEmpty()){
+		QStringList words = read_word_list(parser.value("vocabulary"));
+		if(words.isEmpty()){
+			QTextStream(stderr) << "Failed to read word list " << parser.value("vocabulary") << "\n";
+			return 1;
+		}
+		generator.setVocabulary(options.languages.first().first, words);
+	}
+	QString text = generator.generate();
+
+	QFile output;
+	if(parser.isSet("output")){
+		output.setFileName(parser.value("output"));
+		if(!output.open(QIODevice::WriteOnly)){
+			QTextStream(stderr) << "Failed to open " << output.fileName() << " for writing\n";
+			return 1;
+		}
+	}else{
+		output.open(stdout, QIODevice::WriteOnly);
+	}
+	output.write(text.toUtf8());
+	QTextStream(stderr) << generator.wordCount() << " words, " << generator.typoCount() << " misspellings\n";
+	return 0;
+}
@@ -0,0 +1,187 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "EditDistance.hpp"
+
+#include <QRandomGenerator>
+#include <QVector>
+#include <QtTest>
+#include <algorithm>
+
+// Cross-checks QtSpell::EditDistance against a plain dynamic programming
+// implementation of the optimal string alignment distance on random words.
+// The generator is seeded, so a failure reports the pair that reproduces it.
+
+class EditDistanceTest : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void knownDistances();
+	void randomAscii();
+	void randomNonAscii();
+	void randomLongWords();
+	void randomEdits();
+
+private:
+	static int referenceDistance(const QString& a, const QString& b);
+	static QString randomWord(QRandomGenerator& random, const QString& alphabet, int length);
+	static QString mutate(QRandomGenerator& random, const QString& word, const QString& alphabet, int edits);
+	static void compare(const QString& word, const QString& candidate);
+	static void compareRandom(quint32 seed, const QString& alphabet, int minLength, int maxLength, int count);
+};
+
+int EditDistanceTest::referenceDistance(const QString& a, const QString& b)
+{
+	int m = a.length();
+	int n = b.length();
+	QVector<QVector<int>> d(m + 1, QVector<int>(n + 1));
+	for(int i = 0; i <= m; ++i){
+		d[i][0] = i;
+	}
+	for(int j = 0; j <= n; ++j){
+		d[0][j] = j;
+	}
+	for(int i = 1; i <= m; ++i){
+		for(int j = 1; j <= n; ++j){
+			int cost = a[i - 1] == b[j - 1] ? 0 : 1;
+			d[i][j] = std::min({d[i - 1][j] + 1, d[i][j - 1] + 1, d[i - 1][j - 1] + cost});
+			if(i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1]){
+				d[i][j] = std::min(d[i][j], d[i - 2][j - 2] + 1);
+			}
+		}
+	}
+	return d[m][n];
+}
+
+QString EditDistanceTest::randomWord(QRandomGenerator& random, const QString& alphabet, int length)
+{
+	QString word;
+	word.reserve(length);
+	for(int i = 0; i < length; ++i){
+		word.append(alphabet[random.bounded(alphabet.length())]);
+	}
+	return word;
+}
+
+QString EditDistanceTest::mutate(QRandomGenerator& random, const QString& word, const QString& alphabet, int edits)
+{
+	QString result = word;
+	for(int i = 0; i < edits; ++i){
+		int pos = result.isEmpty() ? 0 : random.bounded(result.length());
+		QChar ch = alphabet[random.bounded(alphabet.length())];
+		switch(random.bounded(4)){
+		case 0:
+			result.insert(pos, ch);
+			break;
+		case 1:
+			result.remove(pos, 1);
+			break;
+		case 2:
+			if(pos < result.length()){
+				result[pos] = ch;
+			}
+			break;
+		default:
+			if(pos + 1 < result.length()){
+				QChar next = result[pos + 1];
+				result[pos + 1] = result[pos];
+				result[pos] = next;
+			}
+			break;
+		}
+	}
+	return result;
+}
+
+void EditDistanceTest::compare(const QString& word, const QString& candidate)
+{
+	int expected = referenceDistance(word, candidate);
+	int actual = QtSpell::EditDistance(word).distance(candidate);
+	QVERIFY2(actual == expected, qPrintable(QString("distance(\"%1\", \"%2\") = %3, expected %4").arg(word, candidate).arg(actual).arg(expected)));
+}
+
+void EditDistanceTest::compareRandom(quint32 seed, const QString& alphabet, int minLength, int maxLength, int count)
+{
+	QRandomGenerator random(seed);
+	for(int i = 0; i < count; ++i){
+		QString word = randomWord(random, alphabet, random.bounded(minLength, maxLength + 1));
+		QString candidate = randomWord(random, alphabet, random.bounded(minLength, maxLength + 1));
+		compare(word, candidate);
+		if(QTest::currentTestFailed()){
+			return;
+		}
+	}
+}
+
+void EditDistanceTest::knownDistances()
+{
+	compare("", "");
+	compare("", "abc");
+	compare("abc", "");
+	compare("abc", "abc");
+	compare("abc", "acb");
+	// Not 2 as with the unrestricted Damerau distance
+	QCOMPARE(QtSpell::EditDistance(QString("ca")).distance(QString("abc")), 3);
+	QCOMPARE(QtSpell::EditDistance(QString("teh")).distance(QString("the")), 1);
+	QCOMPARE(QtSpell::EditDistance(QString("straße")).distance(QString("strasse")), 2);
+	// The boundary between the bit-parallel and the dynamic programming paths
+	compare(QString(64, 'a'), QString(63, 'a') + "b");
+	compare(QString(65, 'a'), QString(64, 'a') + "b");
+	compare(QString(63, 'a') + "ba", QString(64, 'a') + "b");
+}
+
+void EditDistanceTest::randomAscii()
+{
+	// A small alphabet makes matches and transpositions frequent
+	compareRandom(1, "abcd", 0, 12, 20000);
+	compareRandom(2, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ'-", 0, 64, 5000);
+}
+
+void EditDistanceTest::randomNonAscii()
+{
+	// Mixes characters below and above 128, including a surrogate pair whose
+	// code units are matched individually
+	compareRandom(3, QString::fromUtf8("aäoöß€\U0001F600"), 0, 12, 20000);
+	compareRandom(4, QString::fromUtf8("абвгαβ中文"), 0, 64, 5000);
+}
+
+void EditDistanceTest::randomLongWords()
+{
+	compareRandom(5, "abc", 60, 100, 2000);
+	compareRandom(6, QString::fromUtf8("abéü"), 65, 130, 1000);
+}
+
+void EditDistanceTest::randomEdits()
+{
+	// Candidates close to the word, as produced by typing errors
+	QRandomGenerator random(7);
+	QString alphabet = QString::fromUtf8("abcdefghäöüß");
+	for(int i = 0; i < 10000; ++i){
+		QString word = randomWord(random, alphabet, random.bounded(1, 100));
+		compare(word, mutate(random, word, alphabet, random.bounded(1, 5)));
+		if(QTest::currentTestFailed()){
+			return;
+		}
+	}
+}
+
+QTEST_GUILESS_MAIN(EditDistanceTest)
+
+#include "editdistancetest.moc"
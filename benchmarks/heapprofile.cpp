@@ -0,0 +1,296 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "CorpusGenerator.hpp"
+#include "QtSpell.hpp"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QMap>
+#include <QPlainTextEdit>
+#include <QTextStream>
+#include <QVector>
+#include <atomic>
+
+// Measures the heap used by TextEditChecker for documents of increasing size.
+// All allocations of the process are counted by interposing malloc and friends
+// and forwarding them to the glibc implementation.
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#include <errno.h>
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+}
+
+static std::atomic<qint64> s_heapCurrent(0);
+static std::atomic<qint64> s_heapPeak(0);
+
+static void heap_add(void* ptr)
+{
+	if(ptr){
+		qint64 current = s_heapCurrent += malloc_usable_size(ptr);
+		qint64 peak = s_heapPeak.load(std::memory_order_relaxed);
+		while(current > peak && !s_heapPeak.compare_exchange_weak(peak, current, std::memory_order_relaxed)){}
+	}
+}
+
+static void heap_remove(void* ptr)
+{
+	if(ptr){
+		s_heapCurrent -= malloc_usable_size(ptr);
+	}
+}
+
+extern "C" {
+void* malloc(size_t size)
+{
+	void* ptr = __libc_malloc(size);
+	heap_add(ptr);
+	return ptr;
+}
+
+void* calloc(size_t count, size_t size)
+{
+	void* ptr = __libc_calloc(count, size);
+	heap_add(ptr);
+	return ptr;
+}
+
+void* realloc(void* ptr, size_t size)
+{
+	heap_remove(ptr);
+	void* newPtr = __libc_realloc(ptr, size);
+	heap_add(newPtr ? newPtr : (size == 0 ? nullptr : ptr));
+	return newPtr;
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+	void* ptr = __libc_memalign(alignment, size);
+	heap_add(ptr);
+	return ptr;
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+	return memalign(alignment, size);
+}
+
+int posix_memalign(void** result, size_t alignment, size_t size)
+{
+	void* ptr = memalign(alignment, size);
+	if(!ptr){
+		return ENOMEM;
+	}
+	*result = ptr;
+	return 0;
+}
+
+void free(void* ptr)
+{
+	heap_remove(ptr);
+	__libc_free(ptr);
+}
+}
+
+static const bool s_heapTracked = true;
+#else
+static std::atomic<qint64> s_heapCurrent(0);
+static std::atomic<qint64> s_heapPeak(0);
+static const bool s_heapTracked = false;
+#endif
+
+struct StageResult {
+	qint64 peak = 0;
+	qint64 steady = 0;
+};
+
+class StageMeter
+{
+public:
+	StageMeter(){
+		m_base = s_heapCurrent;
+		s_heapPeak = m_base;
+	}
+	StageResult finish(qint64 baseline) const{
+		StageResult result;
+		result.peak = s_heapPeak - baseline;
+		result.steady = s_heapCurrent - baseline;
+		return result;
+	}
+private:
+	qint64 m_base;
+};
+
+static const char* const s_stages[] = {"load", "attach", "check", "edits", "detach"};
+
+static void run_edits(QPlainTextEdit* textEdit, int count, quint64 seed)
+{
+	// Mix of typing, deletions and pasted words at random positions
+	static const QString words[] = {"the ", "spelling ", "teh ", "checker ", "\n", "recieve "};
+	quint64 state = seed;
+	auto next = [&state](){
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		return quint32(state >> 33);
+	};
+	QTextDocument* document = textEdit->document();
+	for(int i = 0; i < count; ++i){
+		QTextCursor cursor(document);
+		cursor.setPosition(next() % document->characterCount());
+		switch(next() % 4){
+		case 0:
+			cursor.insertText(QString(QChar('a' + next() % 26)));
+			break;
+		case 1:
+			cursor.deletePreviousChar();
+			break;
+		case 2:
+			cursor.insertText(words[next() % 6]);
+			break;
+		default:
+			cursor.insertText(QString(QChar(' ')));
+			break;
+		}
+		if(i % 100 == 0){
+			QApplication::processEvents();
+		}
+	}
+	QApplication::processEvents();
+}
+
+int main(int argc, char* argv[])
+{
+	if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")){
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	}
+	QApplication app(argc, argv);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Measures the heap used by TextEditChecker for documents of increasing size.");
+	parser.addHelpOption();
+	parser.addOptions({
+		{"sizes", "Comma separated document sizes in MB.", "list", "1,2,4,8"},
+		{"edits", "Number of random edits in the edit stage.", "n", "10000"},
+		{"language", "Dictionary to check against.", "lang", "en_US"},
+		{"threshold", "Flag stages whose bytes per MB of text grow by more than this factor from the smallest to the largest document.", "factor", "1.5"}
+	});
+	parser.process(app);
+	if(!s_heapTracked){
+		QTextStream(stderr) << "Heap tracking requires glibc\n";
+		return 1;
+	}
+
+	QVector<double> sizes;
+	for(const QString& size : parser.value("sizes").split(',', QString::SkipEmptyParts)){
+		sizes.append(size.toDouble());
+	}
+	int edits = parser.value("edits").toInt();
+	double threshold = parser.value("threshold").toDouble();
+	QString language = parser.value("language");
+
+	QTextStream out(stdout);
+	out << "undo,size_mb,stage,peak_bytes,steady_bytes,peak_per_mb,steady_per_mb\n";
+	// results[undo][stage] = steady bytes per MB for each size
+	QMap<bool, QMap<QString, QVector<double>>> results;
+	bool superlinear = false;
+
+	for(bool undo : {false, true}){
+		for(double sizeMb : sizes){
+			QtSpell::CorpusOptions options;
+			options.size = int(sizeMb * 1024 * 1024);
+			QString text = QtSpell::CorpusGenerator(options).generate();
+
+			qint64 baseline = s_heapCurrent;
+			QMap<QString, StageResult> stages;
+			QPlainTextEdit* textEdit = new QPlainTextEdit;
+			QtSpell::TextEditChecker* checker = new QtSpell::TextEditChecker;
+			if(!checker->setLanguage(language)){
+				QTextStream(stderr) << "Failed to load dictionary for " << language << "\n";
+				return 1;
+			}
+			checker->setUndoRedoEnabled(undo);
+			{
+				StageMeter meter;
+				textEdit->setPlainText(text);
+				stages["load"] = meter.finish(baseline);
+			}
+			{
+				StageMeter meter;
+				checker->setSpellingEnabled(false);
+				checker->setTextEdit(textEdit);
+				stages["attach"] = meter.finish(baseline);
+			}
+			{
+				StageMeter meter;
+				checker->setSpellingEnabled(true);
+				app.processEvents();
+				stages["check"] = meter.finish(baseline);
+			}
+			{
+				StageMeter meter;
+				run_edits(textEdit, edits, 42);
+				stages["edits"] = meter.finish(baseline);
+			}
+			{
+				StageMeter meter;
+				checker->setTextEdit(static_cast<QPlainTextEdit*>(nullptr));
+				delete textEdit;
+				delete checker;
+				app.processEvents();
+				stages["detach"] = meter.finish(baseline);
+			}
+
+			for(const char* stage : s_stages){
+				const StageResult& result = stages[stage];
+				out << (undo ? "on" : "off") << "," << sizeMb << "," << stage << ","
+					<< result.peak << "," << result.steady << ","
+					<< qint64(result.peak / sizeMb) << "," << qint64(result.steady / sizeMb) << "\n";
+				results[undo][stage].append(result.steady / sizeMb);
+			}
+			out.flush();
+		}
+	}
+
+	if(sizes.size() > 1){
+		for(bool undo : {false, true}){
+			for(const char* stage : s_stages){
+				const QVector<double>& perMb = results[undo][stage];
+				double first = qMax(perMb.first(), 1.0);
+				double growth = perMb.last() / first;
+				if(QString(stage) == "detach"){
+					// Anything left behind after detaching grows with the document
+					if(perMb.last() > 64 * 1024){
+						QTextStream(stderr) << "WARNING: undo " << (undo ? "on" : "off") << ": " << qint64(perMb.last()) << " bytes per MB retained after detach\n";
+						superlinear = true;
+					}
+				}else if(growth > threshold){
+					QTextStream(stderr) << "WARNING: undo " << (undo ? "on" : "off") << ", stage " << stage << ": bytes per MB grow " << growth << "x from " << sizes.first() << " MB to " << sizes.last() << " MB\n";
+					superlinear = true;
+				}
+			}
+		}
+	}
+	return superlinear ? 2 : 0;
+}
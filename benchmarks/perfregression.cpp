@@ -0,0 +1,158 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "CorpusGenerator.hpp"
+#include "QtSpell.hpp"
+
+#include <QApplication>
+#include <QPlainTextEdit>
+#include <QtTest>
+
+// Asserts scaling properties of the checking pipeline. The assertions are
+// based on the operation counters of QtSpell::CheckerStatistics rather than on
+// wall time, so that they are stable on loaded CI machines.
+
+class PerfRegressionTest : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void initTestCase();
+	void keystrokeChecksLocalRange();
+	void languageSwitchScalesLinearly();
+	void undoDoesNotReplayHistory();
+
+private:
+	static QString generate(int size);
+	static bool attach(QtSpell::TextEditChecker& checker, QPlainTextEdit& textEdit, const QString& text);
+};
+
+QString PerfRegressionTest::generate(int size)
+{
+	QtSpell::CorpusOptions options;
+	options.size = size;
+	return QtSpell::CorpusGenerator(options).generate();
+}
+
+bool PerfRegressionTest::attach(QtSpell::TextEditChecker& checker, QPlainTextEdit& textEdit, const QString& text)
+{
+	if(!checker.setLanguage("en_US")){
+		return false;
+	}
+	checker.setUndoRedoEnabled(true);
+	textEdit.setPlainText(text);
+	checker.setTextEdit(&textEdit);
+	return true;
+}
+
+void PerfRegressionTest::initTestCase()
+{
+	if(!QtSpell::Checker::getLanguageList().contains("en_US")){
+		QSKIP("The en_US dictionary is not installed");
+	}
+}
+
+void PerfRegressionTest::keystrokeChecksLocalRange()
+{
+	QtSpell::TextEditChecker checker;
+	QPlainTextEdit textEdit;
+	QVERIFY(attach(checker, textEdit, generate(5 * 1024 * 1024)));
+	QCOMPARE(checker.statistics().checkCount, quint64(1));
+
+	checker.resetStatistics();
+	QTextCursor cursor(textEdit.document());
+	cursor.setPosition(textEdit.document()->characterCount() / 2);
+	cursor.insertText("x");
+	QCoreApplication::processEvents();
+
+	QtSpell::CheckerStatistics statistics = checker.statistics();
+	QCOMPARE(statistics.checkCount, quint64(1));
+	// The word the character was typed into, plus its neighbours at most
+	QVERIFY2(statistics.charactersChecked < 256, qPrintable(QString("%1 characters checked").arg(statistics.charactersChecked)));
+	QVERIFY2(statistics.wordsChecked <= 3, qPrintable(QString("%1 words checked").arg(statistics.wordsChecked)));
+}
+
+void PerfRegressionTest::languageSwitchScalesLinearly()
+{
+	QString text = generate(256 * 1024);
+	quint64 words[2];
+	quint64 characters[2];
+	for(int i = 0; i < 2; ++i){
+		QtSpell::TextEditChecker checker;
+		QPlainTextEdit textEdit;
+		// Twice the document: the same text repeated
+		QVERIFY(attach(checker, textEdit, i == 0 ? text : text + "\n" + text));
+		QString other = QtSpell::Checker::getLanguageList().contains("de_DE") ? "de_DE" : "en_US";
+		checker.resetStatistics();
+		QVERIFY(checker.setLanguage(other));
+		QCoreApplication::processEvents();
+		words[i] = checker.statistics().wordsChecked;
+		characters[i] = checker.statistics().charactersChecked;
+		QCOMPARE(checker.statistics().checkCount, quint64(1));
+	}
+	QVERIFY(words[0] > 0);
+	double wordRatio = double(words[1]) / words[0];
+	double characterRatio = double(characters[1]) / characters[0];
+	QVERIFY2(wordRatio > 1.9 && wordRatio < 2.1, qPrintable(QString("word ratio %1").arg(wordRatio)));
+	QVERIFY2(characterRatio > 1.9 && characterRatio < 2.1, qPrintable(QString("character ratio %1").arg(characterRatio)));
+}
+
+void PerfRegressionTest::undoDoesNotReplayHistory()
+{
+	QtSpell::TextEditChecker checker;
+	QPlainTextEdit textEdit;
+	QVERIFY(attach(checker, textEdit, generate(1024 * 1024)));
+
+	// Build up some history before the delete
+	QTextCursor cursor(textEdit.document());
+	for(int i = 0; i < 200; ++i){
+		cursor.setPosition((i * 7919) % (textEdit.document()->characterCount() - 1));
+		cursor.insertText(i % 2 ? "a" : " ");
+	}
+	cursor.setPosition(1000);
+	cursor.setPosition(1010, QTextCursor::KeepAnchor);
+	QString deleted = cursor.selectedText();
+	cursor.removeSelectedText();
+	QCoreApplication::processEvents();
+
+	checker.resetStatistics();
+	checker.undo();
+	QCoreApplication::processEvents();
+
+	QtSpell::CheckerStatistics statistics = checker.statistics();
+	QCOMPARE(statistics.undoRedoSteps, quint64(1));
+	QCOMPARE(statistics.undoRedoCharacters, quint64(deleted.length()));
+	QCOMPARE(statistics.checkCount, quint64(1));
+	QVERIFY2(statistics.charactersChecked < 256, qPrintable(QString("%1 characters checked").arg(statistics.charactersChecked)));
+	cursor.setPosition(1000);
+	cursor.setPosition(1010, QTextCursor::KeepAnchor);
+	QCOMPARE(cursor.selectedText(), deleted);
+}
+
+int main(int argc, char* argv[])
+{
+	if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")){
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	}
+	QApplication app(argc, argv);
+	PerfRegressionTest test;
+	return QTest::qExec(&test, argc, argv);
+}
+
+#include "perfregression.moc"
@@ -0,0 +1,195 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "QtSpell.hpp"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QPlainTextEdit>
+#include <QTextEdit>
+#include <QTextStream>
+#include <QThread>
+
+// Replays a trace written by TextEditChecker::startTraceRecording against a
+// widget on the offscreen platform and reports the latency distribution of the
+// spell checking work triggered by each kind of event.
+
+// The version of the format written by QtSpell::TraceRecorder
+static const int TraceFormatVersion = 1;
+
+static QString event_category(const QJsonObject& event)
+{
+	QString type = event["type"].toString();
+	if(type == "edit"){
+		return "edit:" + event["cause"].toString();
+	}
+	return type;
+}
+
+int main(int argc, char* argv[])
+{
+	if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")){
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	}
+	QApplication app(argc, argv);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Replays QtSpell editing traces and reports per-event latencies.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("trace", "Trace file recorded with TextEditChecker::startTraceRecording.");
+	parser.addOptions({
+		{"realtime", "Wait between events as in the recorded session instead of replaying back to back."},
+		{"repeat", "Number of times to replay the trace.", "n", "1"},
+		{"language", "Override the language of the trace.", "lang"},
+		{"csv", "Write the latency of every replayed event to the file.", "file"}
+	});
+	parser.process(app);
+	if(parser.positionalArguments().size() != 1){
+		parser.showHelp(1);
+	}
+
+	QFile traceFile(parser.positionalArguments().first());
+	if(!traceFile.open(QIODevice::ReadOnly)){
+		QTextStream(stderr) << "Failed to open " << traceFile.fileName() << "\n";
+		return 1;
+	}
+	QList<QJsonObject> events;
+	while(!traceFile.atEnd()){
+		QByteArray line = traceFile.readLine().trimmed();
+		if(line.isEmpty()){
+			continue;
+		}
+		QJsonParseError error;
+		QJsonDocument doc = QJsonDocument::fromJson(line, &error);
+		if(!doc.isObject()){
+			QTextStream(stderr) << "Invalid trace line " << events.size() + 1 << ": " << error.errorString() << "\n";
+			return 1;
+		}
+		events.append(doc.object());
+	}
+	if(events.isEmpty() || events.first()["type"].toString() != "start"){
+		QTextStream(stderr) << "Trace does not begin with a start event\n";
+		return 1;
+	}
+	if(events.first()["version"].toInt() != TraceFormatVersion){
+		QTextStream(stderr) << "Unsupported trace format version " << events.first()["version"].toInt() << "\n";
+		return 1;
+	}
+
+	QFile csv;
+	if(parser.isSet("csv")){
+		csv.setFileName(parser.value("csv"));
+		if(!csv.open(QIODevice::WriteOnly)){
+			QTextStream(stderr) << "Failed to open " << csv.fileName() << " for writing\n";
+			return 1;
+		}
+		csv.write("iteration,index,t_ms,category,latency_us\n");
+	}
+
+	const QJsonObject& start = events.first();
+	QString language = parser.isSet("language") ? parser.value("language") : start["language"].toString();
+	bool plain = start["widget"].toString() == "QPlainTextEdit";
+	int repeat = qMax(1, parser.value("repeat").toInt());
+	QMap<QString, QtSpell::LatencyHistogram> histograms;
+
+	for(int iteration = 0; iteration < repeat; ++iteration){
+		QTextEdit textEdit;
+		QPlainTextEdit plainTextEdit;
+		QTextDocument* document;
+		QtSpell::TextEditChecker checker;
+		if(!checker.setLanguage(language)){
+			QTextStream(stderr) << "Failed to load dictionary for " << language << "\n";
+			return 1;
+		}
+		checker.setUndoRedoEnabled(true);
+
+		QElapsedTimer timer;
+		timer.start();
+		if(plain){
+			plainTextEdit.setPlainText(start["text"].toString());
+			checker.setTextEdit(&plainTextEdit);
+			document = plainTextEdit.document();
+		}else{
+			textEdit.setPlainText(start["text"].toString());
+			checker.setTextEdit(&textEdit);
+			document = textEdit.document();
+		}
+		histograms["attach"].record(timer.nsecsElapsed() / 1000);
+
+		QElapsedTimer clock;
+		clock.start();
+		for(int i = 1, n = events.size(); i < n; ++i){
+			const QJsonObject& event = events[i];
+			QString type = event["type"].toString();
+			if(type == "key"){
+				// Edits are replayed from the resulting edit events
+				continue;
+			}
+			if(parser.isSet("realtime")){
+				qint64 wait = qint64(event["t"].toDouble()) - clock.elapsed();
+				if(wait > 0){
+					QThread::msleep(wait);
+				}
+			}
+			timer.restart();
+			if(type == "edit"){
+				QTextCursor cursor(document);
+				int pos = event["pos"].toInt();
+				cursor.setPosition(qMin(pos, document->characterCount() - 1));
+				cursor.setPosition(qMin(pos + event["removed"].toInt(), document->characterCount() - 1), QTextCursor::KeepAnchor);
+				cursor.insertText(event["text"].toString());
+			}else if(type == "undo"){
+				checker.undo();
+			}else if(type == "redo"){
+				checker.redo();
+			}else if(type == "add" || type == "ignore"){
+				// Don't touch the personal dictionary, ignoring costs the same recheck
+				checker.ignoreWord(event["word"].toString());
+				checker.checkSpelling(event["start"].toInt(), event["end"].toInt());
+			}else if(type == "language"){
+				checker.setLanguage(event["word"].toString());
+			}else{
+				continue;
+			}
+			// Deliver any deferred work (scheduled and revealed block checks)
+			app.processEvents();
+			qint64 usecs = timer.nsecsElapsed() / 1000;
+			QString category = event_category(event);
+			histograms[category].record(usecs);
+			if(csv.isOpen()){
+				csv.write(QString("%1,%2,%3,%4,%5\n").arg(iteration).arg(i).arg(event["t"].toDouble()).arg(category).arg(usecs).toUtf8());
+			}
+		}
+	}
+
+	QTextStream out(stdout);
+	out << qSetFieldWidth(16) << left << "event" << qSetFieldWidth(10) << right << "count" << "p50 us" << "p90 us" << "p99 us" << "max us" << qSetFieldWidth(0) << "\n";
+	for(auto it = histograms.constBegin(), itEnd = histograms.constEnd(); it != itEnd; ++it){
+		const QtSpell::LatencyHistogram& histogram = it.value();
+		out << qSetFieldWidth(16) << left << it.key() << qSetFieldWidth(10) << right << histogram.count()
+			<< histogram.percentile(50) << histogram.percentile(90) << histogram.percentile(99) << histogram.max()
+			<< qSetFieldWidth(0) << "\n";
+	}
+	return 0;
+}
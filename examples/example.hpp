@@ -18,16 +18,19 @@
 
 /**
 * @example example.hpp
-* Simple example demonstrating the use of QtSpell::TextEditChecker
+* Simple example demonstrating the use of QtSpell::TextEditChecker, with
+* large-document scenarios and a live overlay of the checker statistics
 */
 
 #ifndef EXAMPLE_HPP
 #define EXAMPLE_HPP
 
 #include <QCheckBox>
+#include <QElapsedTimer>
 #include <QLabel>
 #include <QMainWindow>
 #include <QTextEdit>
+#include <QTimer>
 #include <QVBoxLayout>
 #include <QtSpell.hpp>
 #include <QDialogButtonBox>
@@ -59,6 +62,19 @@ public:
 		QPushButton* buttonDetach = bbox->addButton("Detach", QDialogButtonBox::ActionRole);
 		QPushButton* buttonAttach = bbox->addButton("Attach", QDialogButtonBox::ActionRole);
 
+		// Reproducible workloads for spotting performance regressions
+		QDialogButtonBox* scenarioBox = new QDialogButtonBox(this);
+		QPushButton* buttonLoad1 = scenarioBox->addButton("Load 1 MB", QDialogButtonBox::ActionRole);
+		QPushButton* buttonLoad10 = scenarioBox->addButton("Load 10 MB", QDialogButtonBox::ActionRole);
+		QPushButton* buttonLoad50 = scenarioBox->addButton("Load 50 MB", QDialogButtonBox::ActionRole);
+		QPushButton* buttonPaste = scenarioBox->addButton("Paste block", QDialogButtonBox::ActionRole);
+		QPushButton* buttonLanguage = scenarioBox->addButton("Switch language", QDialogButtonBox::ActionRole);
+
+		m_hud = new QLabel(m_textEdit);
+		m_hud->setAttribute(Qt::WA_TransparentForMouseEvents);
+		m_hud->setStyleSheet("background: rgba(0, 0, 0, 160); color: white; padding: 4px; font-family: monospace;");
+		m_hud->move(8, 8);
+
 		QWidget* widget = new QWidget(this);
 		setCentralWidget(widget);
 
@@ -66,6 +82,7 @@ public:
 		layout->addWidget(label);
 		layout->addWidget(m_textEdit, 1);
 		layout->addWidget(bbox);
+		layout->addWidget(scenarioBox);
 
 
 		m_checker = new QtSpell::TextEditChecker(this);
@@ -82,6 +99,16 @@ public:
 		connect(buttonClear, &QPushButton::clicked, m_checker, &QtSpell::TextEditChecker::clearUndoRedo);
 		connect(buttonDetach, &QPushButton::clicked, this, &MainWindow::detach);
 		connect(buttonAttach, &QPushButton::clicked, this, &MainWindow::attach);
+		connect(buttonLoad1, &QPushButton::clicked, this, [this]{ loadDocument(1); });
+		connect(buttonLoad10, &QPushButton::clicked, this, [this]{ loadDocument(10); });
+		connect(buttonLoad50, &QPushButton::clicked, this, [this]{ loadDocument(50); });
+		connect(buttonPaste, &QPushButton::clicked, this, &MainWindow::pasteBlock);
+		connect(buttonLanguage, &QPushButton::clicked, this, &MainWindow::switchLanguage);
+
+		QTimer* hudTimer = new QTimer(this);
+		connect(hudTimer, &QTimer::timeout, this, &MainWindow::updateHud);
+		hudTimer->start(250);
+		updateHud();
 	}
 
 private slots:
@@ -91,10 +118,84 @@ private slots:
 	void detach() {
 		m_checker->setTextEdit(static_cast<QTextEdit*>(nullptr));
 	}
+	void loadDocument(int megabytes) {
+		QString text = generateText(megabytes * 1024 * 1024);
+		QElapsedTimer timer;
+		timer.start();
+		m_textEdit->setPlainText(text);
+		m_lastAction = QString("Load %1 MB").arg(megabytes);
+		m_lastActionMsecs = timer.elapsed();
+	}
+	void pasteBlock() {
+		QString text = generateText(64 * 1024);
+		QElapsedTimer timer;
+		timer.start();
+		m_textEdit->textCursor().insertText(text);
+		m_lastAction = "Paste block";
+		m_lastActionMsecs = timer.elapsed();
+	}
+	void switchLanguage() {
+		QList<QString> languages = QtSpell::Checker::getLanguageList();
+		if(languages.isEmpty()) {
+			return;
+		}
+		QString lang = languages[(languages.indexOf(m_checker->getLanguage()) + 1) % languages.size()];
+		QElapsedTimer timer;
+		timer.start();
+		m_checker->setLanguage(lang);
+		m_lastAction = QString("Switch to %1").arg(lang);
+		m_lastActionMsecs = timer.elapsed();
+	}
+	void updateHud() {
+		QtSpell::CheckerStatistics stats = m_checker->statistics();
+		const QtSpell::LatencyHistogram& latency = m_checker->keystrokeLatency();
+		m_hud->setText(QString("%1: %2 ms\n"
+							   "Last check: %3 ms (%4 checks)\n"
+							   "Queue depth: %5\n"
+							   "Cache hit rate: %6 %\n"
+							   "Keystroke p50/p99/max: %7 / %8 / %9 ms")
+					   .arg(m_lastAction).arg(m_lastActionMsecs)
+					   .arg(stats.lastCheckUsecs / 1000.0, 0, 'f', 1).arg(stats.checkCount)
+					   .arg(stats.pendingChecks)
+					   .arg(stats.cacheHitRate() * 100.0, 0, 'f', 1)
+					   .arg(latency.percentile(50) / 1000.0, 0, 'f', 1)
+					   .arg(latency.percentile(99) / 1000.0, 0, 'f', 1)
+					   .arg(latency.max() / 1000.0, 0, 'f', 1));
+		m_hud->adjustSize();
+	}
 
 private:
 	QtSpell::TextEditChecker* m_checker = nullptr;
 	QTextEdit* m_textEdit = nullptr;
+	QLabel* m_hud = nullptr;
+	QString m_lastAction = "Last action";
+	qint64 m_lastActionMsecs = 0;
+
+	// Deterministic text with a sprinkling of misspellings
+	static QString generateText(int size) {
+		static const char* const words[] = {
+			"the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "spelling",
+			"checker", "document", "performance", "latency", "keyboard", "paragraph",
+			"sentence", "isn't", "won't", "editor", "text", "widget", "memory", "cache",
+			"dictionary", "recieve", "teh", "wierd", "langauge"
+		};
+		const quint32 numWords = sizeof(words) / sizeof(words[0]);
+		QString text;
+		text.reserve(size);
+		quint32 state = 42;
+		int wordsInLine = 0;
+		while(text.size() < size) {
+			state = state * 1664525u + 1013904223u;
+			text += QLatin1String(words[(state >> 16) % numWords]);
+			if(++wordsInLine == 12) {
+				text += (state >> 8) % 4 == 0 ? "\n\n" : "\n";
+				wordsInLine = 0;
+			} else {
+				text += ' ';
+			}
+		}
+		return text;
+	}
 };
 
 #endif // EXAMPLE_HPP
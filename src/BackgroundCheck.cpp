@@ -0,0 +1,191 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "BackgroundCheck.hpp"
+#include "TextEditChecker_p.hpp"
+#include "Tokenizer.hpp"
+
+#include <QElapsedTimer>
+#include <QRunnable>
+#include <QSet>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QThreadPool>
+
+namespace QtSpell {
+
+// Characters per chunk, complete blocks are checked in any case
+static const int CHUNK_CHARS = 16 * 1024;
+
+class BackgroundCheck::LookupTask : public QRunnable
+{
+public:
+	LookupTask(BackgroundCheck* check, const QStringList& words, int generation)
+		: m_check(check), m_words(words), m_generation(generation) {}
+	void run(){
+		m_check->lookup(m_words, m_generation);
+	}
+
+private:
+	BackgroundCheck* m_check;
+	QStringList m_words;
+	int m_generation;
+};
+
+BackgroundCheck::BackgroundCheck(TextEditCheckerPrivate* d, DocumentState* state)
+	: m_d(d), m_state(state)
+{
+	m_timer.setSingleShot(true);
+	connect(&m_timer, &QTimer::timeout, this, &BackgroundCheck::dispatchChunk);
+}
+
+BackgroundCheck::~BackgroundCheck()
+{
+	cancel();
+}
+
+void BackgroundCheck::start(QTextDocument* document)
+{
+	cancel();
+	m_running = true;
+	m_next = QTextCursor(document);
+	dispatchChunk();
+}
+
+void BackgroundCheck::cancel()
+{
+	m_timer.stop();
+	m_running = false;
+	m_next = QTextCursor();
+	m_chunk = QTextCursor();
+	++m_generation;
+	m_stop = Cancelled;
+	QMutexLocker locker(&m_mutex);
+	waitForTasks();
+	m_verdicts.clear();
+}
+
+void BackgroundCheck::dispatchChunk()
+{
+	if(m_next.isNull() || m_next.atEnd()){
+		// Done, or the document was deleted
+		cancel();
+		return;
+	}
+	// Select complete blocks up to the chunk size
+	QTextBlock block = m_next.block();
+	m_chunk = QTextCursor(block);
+	int chars = 0;
+	QStringList words;
+	QSet<QString> seen;
+	for(; block.isValid() && chars < CHUNK_CHARS; block = block.next()){
+		m_chunk.setPosition(block.position() + block.length() - 1, QTextCursor::KeepAnchor);
+		QString text = block.text();
+		chars += text.length();
+		// Collect the words not in the verdict cache
+		Tokenizer<> tokenizer(text);
+		int start, end;
+		while(tokenizer.next(&start, &end)){
+			if(end - start >= 2){
+				QString word = tokenizer.word(start, end);
+				if(!m_d->verdictCache.contains(word) && !seen.contains(word)){
+					seen.insert(word);
+					words.append(word);
+				}
+			}
+		}
+	}
+	m_next = QTextCursor(m_chunk);
+	m_next.clearSelection();
+	m_next.movePosition(QTextCursor::NextCharacter);
+
+	{
+		QMutexLocker locker(&m_mutex);
+		m_stop = NoStop;
+		++m_tasksRunning;
+	}
+	workerPool()->start(new LookupTask(this, words, m_generation));
+}
+
+void BackgroundCheck::lookup(const QStringList& words, int generation)
+{
+	WorkerSettings settings = workerSettings();
+	QThread::currentThread()->setPriority(settings.priority);
+	QElapsedTimer timer;
+	timer.start();
+	QHash<QString, bool> verdicts;
+	bool complete = true;
+	for(const QString& word : words){
+		if(stopRequested()){
+			complete = false;
+			break;
+		}
+		bool correct;
+		if(m_d->lookupWord(word, &correct)){
+			verdicts.insert(word, correct);
+		}
+	}
+	// Pause in proportion to the work done, in slices to stay responsive to cancellation
+	qint64 pauseUsecs = qint64(timer.nsecsElapsed() / 1000 * (1. - settings.dutyCycle) / settings.dutyCycle);
+	for(; pauseUsecs > 0 && !stopRequested(); pauseUsecs -= 10000){
+		QThread::usleep(qMin(pauseUsecs, Q_INT64_C(10000)));
+	}
+
+	QMutexLocker locker(&m_mutex);
+	if(m_stop.load() != Cancelled){
+		m_verdicts = verdicts;
+		QMetaObject::invokeMethod(this, "applyChunk", Qt::QueuedConnection, Q_ARG(int, generation), Q_ARG(bool, complete));
+	}
+	--m_tasksRunning;
+	m_idle.wakeAll();
+}
+
+void BackgroundCheck::applyChunk(int generation, bool complete)
+{
+	if(generation != m_generation || m_chunk.isNull()){
+		// Results of a cancelled run
+		return;
+	}
+	QHash<QString, bool> verdicts;
+	{
+		QMutexLocker locker(&m_mutex);
+		verdicts.swap(m_verdicts);
+	}
+	for(QHash<QString, bool>::const_iterator it = verdicts.constBegin(), itEnd = verdicts.constEnd(); it != itEnd; ++it){
+		m_d->cacheVerdict(it.key(), it.value());
+	}
+	if(!complete){
+		// Interrupted by fork(), dispatch the chunk again for the words left
+		m_next = QTextCursor(m_chunk);
+		m_next.setPosition(m_chunk.selectionStart());
+		m_chunk = QTextCursor();
+		m_timer.start(0);
+		return;
+	}
+	// The chunk cursor followed any edits made in the meantime
+	QElapsedTimer timer;
+	timer.start();
+	m_d->checkSpelling(m_state, m_chunk.selectionStart(), m_chunk.selectionEnd());
+	m_chunk = QTextCursor();
+
+	double dutyCycle = workerSettings().dutyCycle;
+	m_timer.start(int(timer.elapsed() * (1. - dutyCycle) / dutyCycle));
+}
+
+} // QtSpell
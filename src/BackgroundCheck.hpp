@@ -0,0 +1,82 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef QTSPELL_BACKGROUNDCHECK_HPP
+#define QTSPELL_BACKGROUNDCHECK_HPP
+
+#include "Checker_p.hpp"
+
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include <QTextCursor>
+#include <QTimer>
+
+namespace QtSpell {
+
+class TextEditCheckerPrivate;
+struct DocumentState;
+
+/**
+ * @brief Checks a document chunk by chunk from the event loop, with the
+ *        dictionary lookups of each chunk running on a worker thread.
+ */
+class BackgroundCheck : public QObject, public WorkerClient
+{
+	Q_OBJECT
+public:
+	BackgroundCheck(TextEditCheckerPrivate* d, DocumentState* state);
+	~BackgroundCheck();
+
+	/**
+	 * @brief (Re)start checking the document from its start.
+	 */
+	void start(QTextDocument* document);
+
+	/**
+	 * @brief Stop checking, waiting for a running lookup to finish.
+	 */
+	void cancel();
+
+	bool isRunning() const{ return m_running; }
+
+private slots:
+	void dispatchChunk();
+	void applyChunk(int generation, bool complete);
+
+private:
+	class LookupTask;
+
+	TextEditCheckerPrivate* m_d;
+	DocumentState* m_state;
+	QTextCursor m_next;
+	QTextCursor m_chunk;
+	QTimer m_timer;
+	bool m_running = false;
+	int m_generation = 0;
+
+	// Shared with the worker thread, besides the state of WorkerClient
+	QHash<QString, bool> m_verdicts;
+
+	void lookup(const QStringList& words, int generation);
+};
+
+} // QtSpell
+
+#endif // QTSPELL_BACKGROUNDCHECK_HPP
@@ -19,14 +19,34 @@
 #include "QtSpell.hpp"
 #include "Checker_p.hpp"
 #include "Codetable.hpp"
+#include "EditDistance.hpp"
+#include "SuggestionPrefetch.hpp"
+#include "TraceRecorder.hpp"
 
 #include <enchant++.h>
 #include <QApplication>
+#include <QAtomicPointer>
 #include <QLibraryInfo>
 #include <QLocale>
 #include <QMenu>
+#include <QMutexLocker>
+#include <QThreadPool>
 #include <QTranslator>
+#include <QVector>
 #include <QtDebug>
+#include <algorithm>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#ifdef Q_OS_UNIX
+#include <pthread.h>
+#endif
+
+// Default cache sizes in bytes, see Checker::trimCaches to shrink them
+static const qint64 VERDICT_CACHE_MAX_BYTES = 4 * 1024 * 1024;
+static const int SUGGESTION_CACHE_MAX_BYTES = 1024 * 1024;
+// Suggestions passed on to the context menu, ten are shown plus a "More..." submenu
+static const int SUGGESTION_MAX_COUNT = 20;
 
 static void dict_describe_cb(const char* const lang_tag,
 							 const char* const /*provider_name*/,
@@ -47,6 +67,107 @@ static enchant::Broker* get_enchant_broker() {
 #endif
 }
 
+// Orders the suggestions by their edit distance to the word, keeping the order of
+// the dictionary among equally distant ones. Far off suggestions are dropped as
+// long as a closer one remains.
+static QList<QString> rank_suggestions(const QString& word, const QList<QString>& suggestions)
+{
+	QtSpell::EditDistance editDistance(word);
+	QVector<QPair<int, QString>> scored;
+	scored.reserve(suggestions.size());
+	foreach(const QString& suggestion, suggestions){
+		scored.append(qMakePair(editDistance.distance(suggestion), suggestion));
+	}
+	std::stable_sort(scored.begin(), scored.end(), [](const QPair<int, QString>& a, const QPair<int, QString>& b){
+		return a.first < b.first;
+	});
+	int maxDistance = qMax(2, word.length() / 2);
+	QList<QString> ranked;
+	for(const QPair<int, QString>& entry : scored){
+		if(ranked.size() >= SUGGESTION_MAX_COUNT || (entry.first > maxDistance && !ranked.isEmpty())){
+			break;
+		}
+		ranked.append(entry.second);
+	}
+	return ranked;
+}
+
+static qint64 heap_bytes_in_use()
+{
+#ifdef __GLIBC__
+#if __GLIBC_PREREQ(2, 33)
+	struct mallinfo2 info = mallinfo2();
+	return qint64(info.uordblks + info.hblkhd);
+#endif
+#endif
+	return -1;
+}
+
+static QHash<QString, QtSpell::PooledDictionary*>& dictionary_pool()
+{
+	static QHash<QString, QtSpell::PooledDictionary*> pool;
+	return pool;
+}
+
+// Dictionaries are requested from the broker once per language and shared by
+// all checkers, so that short-lived checkers only pay for a hash lookup. Unused
+// dictionaries stay loaded until unload_unused_dictionaries is called.
+// Call with the enchant lock held.
+static QtSpell::PooledDictionary* pooled_dictionary(const QString& lang)
+{
+	QHash<QString, QtSpell::PooledDictionary*>& pool = dictionary_pool();
+	QHash<QString, QtSpell::PooledDictionary*>::const_iterator it = pool.constFind(lang);
+	if(it != pool.constEnd()){
+		return it.value();
+	}
+	// The heap growth includes allocations of other threads made meanwhile,
+	// the size is an estimate
+	qint64 heapBefore = heap_bytes_in_use();
+	// Throws if the dictionary cannot be loaded, the pool is only changed on success
+	enchant::Dict* dict = get_enchant_broker()->request_dict(lang.toStdString());
+	qint64 heapAfter = heap_bytes_in_use();
+	QtSpell::PooledDictionary* entry = new QtSpell::PooledDictionary;
+	entry->dict = dict;
+	if(heapBefore >= 0 && heapAfter >= 0){
+		entry->size = qMax(Q_INT64_C(0), heapAfter - heapBefore);
+	}
+	pool.insert(lang, entry);
+	return entry;
+}
+
+// Call with the enchant lock held
+static int unload_unused_dictionaries()
+{
+	int count = 0;
+	QHash<QString, QtSpell::PooledDictionary*>& pool = dictionary_pool();
+	for(QHash<QString, QtSpell::PooledDictionary*>::iterator it = pool.begin(); it != pool.end();){
+		if(it.value()->refs > 0){
+			++it;
+			continue;
+		}
+		// Returns the dictionary to the broker
+		delete it.value()->dict;
+		delete it.value();
+		++count;
+		it = pool.erase(it);
+	}
+	return count;
+}
+
+// The memory of all loaded dictionaries, -1 if it cannot be determined.
+// Call with the enchant lock held.
+static qint64 pooled_dictionaries_size()
+{
+	qint64 total = 0;
+	foreach(const QtSpell::PooledDictionary* entry, dictionary_pool()){
+		if(entry->size < 0){
+			return -1;
+		}
+		total += entry->size;
+	}
+	return total;
+}
+
 
 class TranslationsInit {
 public:
@@ -66,25 +187,302 @@ private:
 
 namespace QtSpell {
 
+// Dictionaries are shared between checkers by the broker and used by the worker
+// threads. Never emit signals while holding it.
+Q_GLOBAL_STATIC(QMutex, s_enchantMutex)
+Q_GLOBAL_STATIC(QMutex, s_workerSettingsMutex)
+Q_GLOBAL_STATIC(WorkerSettings, s_workerSettings)
+// Not destroyed at exit, so that a forked child never waits for the threads of its parent
+static QAtomicPointer<QThreadPool> s_workerPool;
+
+Q_GLOBAL_STATIC(QMutex, s_workerClientsMutex)
+Q_GLOBAL_STATIC(QList<WorkerClient*>, s_workerClients)
+
+#ifdef Q_OS_UNIX
+// Hold the locks across fork(), so that the child never inherits them locked
+// by a thread which does not exist in the child. The workers need the locks,
+// so their work is interrupted and drained first. The enchant lock is never
+// held while user code runs, so the forking thread cannot be holding it while
+// a worker waits for it.
+static void atfork_prepare()
+{
+	WorkerClient::drainAll();
+	s_workerSettingsMutex()->lock();
+	s_enchantMutex()->lock();
+}
+
+static void atfork_parent()
+{
+	s_enchantMutex()->unlock();
+	s_workerSettingsMutex()->unlock();
+	WorkerClient::unlockAll();
+}
+
+static void atfork_child()
+{
+	s_enchantMutex()->unlock();
+	s_workerSettingsMutex()->unlock();
+	WorkerClient::unlockAll();
+	// Threads do not survive fork(), the child starts over with a pool of its
+	// own. The pool of the parent is leaked on purpose: its destructor would
+	// wait for threads which do not exist in the child.
+	s_workerPool.store(nullptr);
+}
+#endif
+
+QMutex* enchantMutex()
+{
+#ifdef Q_OS_UNIX
+	// All enchant use passes through here, so the handlers are in place before it is first locked
+	static int atforkResult = pthread_atfork(atfork_prepare, atfork_parent, atfork_child);
+	Q_UNUSED(atforkResult);
+#endif
+	return s_enchantMutex();
+}
+
+WorkerSettings workerSettings()
+{
+	QMutexLocker locker(s_workerSettingsMutex());
+	return *s_workerSettings();
+}
+
+QThreadPool* workerPool()
+{
+	QThreadPool* pool = s_workerPool.loadAcquire();
+	if(!pool){
+		pool = new QThreadPool;
+		pool->setMaxThreadCount(qMax(1, workerSettings().maxThreads));
+		if(!s_workerPool.testAndSetOrdered(nullptr, pool)){
+			delete pool;
+			pool = s_workerPool.loadAcquire();
+		}
+	}
+	return pool;
+}
+
+WorkerClient::WorkerClient()
+{
+	QMutexLocker locker(s_workerClientsMutex());
+	s_workerClients()->append(this);
+}
+
+WorkerClient::~WorkerClient()
+{
+	if(s_workerClients.isDestroyed()){
+		return;
+	}
+	QMutexLocker locker(s_workerClientsMutex());
+	s_workerClients()->removeOne(this);
+}
+
+void WorkerClient::waitForTasks()
+{
+	while(m_tasksRunning > 0){
+		m_idle.wait(&m_mutex);
+	}
+}
+
+void WorkerClient::drainAll()
+{
+	if(s_workerClients.isDestroyed()){
+		return;
+	}
+	s_workerClientsMutex()->lock();
+	// Cut the work in flight short, so that fork() is not held up by long
+	// lookups or by the pauses of the duty cycle
+	foreach(WorkerClient* client, *s_workerClients()){
+		client->m_stop.testAndSetOrdered(NoStop, Interrupted);
+	}
+	foreach(WorkerClient* client, *s_workerClients()){
+		client->m_mutex.lock();
+		client->waitForTasks();
+	}
+}
+
+void WorkerClient::unlockAll()
+{
+	if(s_workerClients.isDestroyed()){
+		return;
+	}
+	foreach(WorkerClient* client, *s_workerClients()){
+		client->m_stop.testAndSetOrdered(Interrupted, NoStop);
+		client->m_mutex.unlock();
+	}
+	s_workerClientsMutex()->unlock();
+}
+
+// Process-wide state which is initialized on first use. Checker::preload
+// initializes it before fork(), so that forked children neither repeat the work
+// nor block on an initialization another thread of the parent had in progress.
+static void init_globals()
+{
+	static TranslationsInit tsInit;
+	Q_UNUSED(tsInit);
+	static int metaTypeId = qRegisterMetaType<SlowOperationInfo>("QtSpell::SlowOperationInfo");
+	Q_UNUSED(metaTypeId);
+}
+
+Q_LOGGING_CATEGORY(qtspellCheck, "qtspell.check", QtWarningMsg)
+Q_LOGGING_CATEGORY(qtspellDict, "qtspell.dict", QtWarningMsg)
+Q_LOGGING_CATEGORY(qtspellTokenize, "qtspell.tokenize", QtWarningMsg)
+Q_LOGGING_CATEGORY(qtspellUndo, "qtspell.undo", QtWarningMsg)
+
 CheckerPrivate::CheckerPrivate()
 {
+	suggestionCache.setMaxCost(SUGGESTION_CACHE_MAX_BYTES);
 }
 
 CheckerPrivate::~CheckerPrivate()
 {
-	delete speller;
+	// The dictionary belongs to the pool
+	if(pooled){
+		QMutexLocker locker(enchantMutex());
+		--pooled->refs;
+	}
+	delete traceRecorder;
 }
 
 void CheckerPrivate::init()
 {
-	static TranslationsInit tsInit;
-	Q_UNUSED(tsInit);
+	init_globals();
 
-	setLanguageInternal("");
+	// The system language is only resolved on first use, most checkers get an explicit one
+	languagePending = true;
+}
+
+enchant::Dict* CheckerPrivate::dict() const
+{
+	if(languagePending){
+		const_cast<CheckerPrivate*>(this)->setLanguageInternal("");
+	}
+	return pooled ? pooled->dict : nullptr;
+}
+
+void CheckerPrivate::reportSlowOperation(const SlowOperationInfo& info) const
+{
+	qCWarning(qtspellCheck) << "Slow" << info.operation << "took" << info.elapsedUsecs / 1000 << "ms:"
+			   << "language" << info.language << "range size" << info.rangeSize
+			   << "word count" << info.wordCount
+			   << "slowest word" << info.slowestWord << "(" << info.slowestWordUsecs / 1000 << "ms )";
+	emit q_ptr->slowOperation(info);
+}
+
+void CheckerPrivate::cacheVerdict(const QString& word, bool correct) const
+{
+	qint64 cost = stringMemoryUsage(word) + sizeof(bool) + 4 * sizeof(void*);
+	if(verdictCacheBytes + cost > VERDICT_CACHE_MAX_BYTES){
+		verdictCache.clear();
+		verdictCacheBytes = 0;
+	}
+	verdictCache.insert(word, correct);
+	verdictCacheBytes += cost;
+}
+
+void CheckerPrivate::cacheSuggestions(const QString& word, const QList<QString>& suggestions) const
+{
+	qint64 cost = stringMemoryUsage(word) + sizeof(QList<QString>) + 4 * sizeof(void*);
+	foreach(const QString& suggestion, suggestions){
+		cost += stringMemoryUsage(suggestion) + sizeof(void*);
+	}
+	suggestionCache.insert(word, new QList<QString>(suggestions), int(cost));
+}
+
+void CheckerPrivate::clearCaches() const
+{
+	verdictCache.clear();
+	verdictCacheBytes = 0;
+	suggestionCache.clear();
+	++cacheGeneration;
+}
+
+void CheckerPrivate::syncDictionaryGeneration() const
+{
+	// Other checkers of the language may have added or ignored words since
+	int generation = pooled ? pooled->generation.loadAcquire() : 0;
+	if(generation != dictionaryGeneration){
+		clearCaches();
+		dictionaryGeneration = generation;
+	}
+}
+
+void CheckerPrivate::trimCaches(qint64 maxBytes)
+{
+	maxBytes = qMax(Q_INT64_C(0), maxBytes);
+	if(verdictCacheBytes > maxBytes){
+		verdictCache.clear();
+		verdictCacheBytes = 0;
+	}
+	qint64 remaining = maxBytes - verdictCacheBytes;
+	if(suggestionCache.totalCost() > remaining){
+		// Shrinking the maximum cost evicts the least recently used entries
+		int maxCost = suggestionCache.maxCost();
+		suggestionCache.setMaxCost(int(remaining));
+		suggestionCache.setMaxCost(maxCost);
+	}
+}
+
+void CheckerPrivate::memoryUsage(MemoryUsage& usage) const
+{
+	QMutexLocker locker(enchantMutex());
+	usage.dictionaries = pooled_dictionaries_size();
+	locker.unlock();
+	usage.verdictCache = verdictCacheBytes;
+	usage.suggestionCache = suggestionCache.totalCost();
+	usage.codetable = Codetable::isLoaded() ? Codetable::instance()->memoryUsage() : 0;
+}
+
+double CheckerStatistics::cacheHitRate() const
+{
+	quint64 lookups = cacheHits + cacheMisses;
+	return lookups > 0 ? double(cacheHits) / lookups : 0.;
+}
+
+qint64 MemoryUsage::total() const
+{
+	return qMax(Q_INT64_C(0), dictionaries) + verdictCache + suggestionCache + undoStack + documentIndexes + codetable;
+}
+
+OperationWatch::OperationWatch(const CheckerPrivate* d, const char* operation, int rangeSize)
+	: m_d(d)
+	, m_active(d->slowOperationThreshold >= 0)
+{
+	if(m_active){
+		m_info.operation = QString::fromLatin1(operation);
+		m_info.rangeSize = rangeSize;
+		m_timer.start();
+	}
+}
+
+OperationWatch::~OperationWatch()
+{
+	if(!m_active){
+		return;
+	}
+	m_info.elapsedUsecs = m_timer.nsecsElapsed() / 1000;
+	if(m_info.elapsedUsecs >= m_d->slowOperationThreshold * Q_INT64_C(1000)){
+		if(m_info.language.isEmpty()){
+			m_info.language = m_d->lang;
+		}
+		m_d->reportSlowOperation(m_info);
+	}
+}
+
+void OperationWatch::finishWord(const QString& word)
+{
+	if(!m_active){
+		return;
+	}
+	qint64 elapsed = m_wordTimer.nsecsElapsed() / 1000;
+	++m_info.wordCount;
+	if(m_info.slowestWord.isEmpty() || elapsed > m_info.slowestWordUsecs){
+		m_info.slowestWord = word;
+		m_info.slowestWordUsecs = elapsed;
+	}
 }
 
 bool checkLanguageInstalled(const QString &lang)
 {
+	QMutexLocker locker(enchantMutex());
 	return get_enchant_broker()->dict_exists(lang.toStdString());
 }
 
@@ -106,6 +504,9 @@ Checker::Checker(CheckerPrivate& dd, QObject* parent)
 
 Checker::~Checker()
 {
+	// Running lookups use the private data
+	delete d_ptr->suggestionPrefetch;
+	d_ptr->suggestionPrefetch = nullptr;
 	delete d_ptr;
 }
 
@@ -122,34 +523,87 @@ bool Checker::setLanguage(const QString &lang)
 QString Checker::getLanguage() const
 {
 	Q_D(const Checker);
+	d->dict();
 	return d->lang;
 }
 
+bool CheckerPrivate::lookupWord(const QString& word, bool* correct) const
+{
+	QByteArray utf8 = word.toUtf8();
+	QMutexLocker locker(enchantMutex());
+	if(!pooled){
+		return false;
+	}
+	try{
+		*correct = pooled->dict->check(utf8.data());
+	}catch(const enchant::Exception&){
+		return false;
+	}
+	return true;
+}
+
+QList<QString> CheckerPrivate::suggestWord(const QString& word) const
+{
+	QByteArray utf8 = word.toUtf8();
+	std::vector<std::string> suggestions;
+	QMutexLocker locker(enchantMutex());
+	if(!pooled){
+		return QList<QString>();
+	}
+	pooled->dict->suggest(utf8.data(), suggestions);
+	locker.unlock();
+	QList<QString> list;
+	for(std::size_t i = 0, n = suggestions.size(); i < n; ++i){
+		list.append(QString::fromUtf8(suggestions[i].c_str()));
+	}
+	return rank_suggestions(word, list);
+}
+
 bool CheckerPrivate::setLanguageInternal(const QString &newLang)
 {
-	delete speller;
-	speller = nullptr;
+	OperationWatch watch(this, "setLanguage");
+	watch.setLanguage(newLang);
+	QMutexLocker locker(enchantMutex());
+	languagePending = false;
+	if(pooled){
+		--pooled->refs;
+		pooled = nullptr;
+	}
 	lang = newLang;
+	clearCaches();
 
 	// Determine language from system locale
 	if(lang.isEmpty()){
 		lang = QLocale::system().name();
 		if(lang.toLower() == "c" || lang.isEmpty()){
-			qWarning() << "Cannot use system locale " << lang;
+			qCWarning(qtspellDict) << "Cannot use system locale " << lang;
 			lang = QString();
 			return false;
 		}
 	}
 
-	// Request dictionary
-	try {
-		speller = get_enchant_broker()->request_dict(lang.toStdString());
-	} catch(enchant::Exception& e) {
-		qWarning() << "Failed to load dictionary: " << e.what();
-		lang = QString();
+	// Request dictionary. The load is reported once the lock is released, slots
+	// connected to slowOperation may use the dictionaries themselves.
+	bool loaded = true;
+	{
+		OperationWatch loadWatch(this, "loadDictionary");
+		loadWatch.setLanguage(lang);
+		try {
+			pooled = pooled_dictionary(lang);
+			++pooled->refs;
+			dictionaryGeneration = pooled->generation.loadAcquire();
+		} catch(enchant::Exception& e) {
+			qCWarning(qtspellDict) << "Failed to load dictionary: " << e.what();
+			lang = QString();
+			loaded = false;
+		}
+		locker.unlock();
+	}
+	if(!loaded){
 		return false;
 	}
 
+	qCDebug(qtspellDict) << "Loaded dictionary for" << lang;
 	return true;
 }
 
@@ -186,52 +640,214 @@ bool Checker::getSpellingEnabled() const
 void Checker::addWordToDictionary(const QString &word)
 {
 	Q_D(Checker);
-	if(d->speller){
-		d->speller->add(word.toUtf8().data());
+	if(enchant::Dict* speller = d->dict()){
+		QMutexLocker locker(enchantMutex());
+		speller->add(word.toUtf8().data());
+		locker.unlock();
+		d->pooled->generation.ref();
+		d->dictionaryChanged();
 	}
 }
 
 bool Checker::checkWord(const QString &word) const
 {
 	Q_D(const Checker);
-	if(!d->speller || !d->spellingEnabled){
+	if(!d->spellingEnabled || !d->dict()){
 		return true;
 	}
 	// Skip empty strings and single characters
 	if(word.length() < 2){
 		return true;
 	}
-	try{
-		return d->speller->check(word.toUtf8().data());
-	}catch(const enchant::Exception&){
+	++d->statistics.wordsChecked;
+	d->syncDictionaryGeneration();
+	QHash<QString, bool>::const_iterator it = d->verdictCache.constFind(word);
+	if(it != d->verdictCache.constEnd()){
+		++d->statistics.cacheHits;
+		return it.value();
+	}
+	++d->statistics.cacheMisses;
+	bool correct;
+	QElapsedTimer timer;
+	timer.start();
+	if(!d->lookupWord(word, &correct)){
 		return true;
 	}
+	d->lookupLatency.record(timer.nsecsElapsed() / 1000);
+	d->cacheVerdict(word, correct);
+	return correct;
 }
 
 void Checker::ignoreWord(const QString &word) const
 {
 	Q_D(const Checker);
-	d->speller->add_to_session(word.toUtf8().data());
+	enchant::Dict* speller = d->dict();
+	if(!speller){
+		return;
+	}
+	QMutexLocker locker(enchantMutex());
+	speller->add_to_session(word.toUtf8().data());
+	locker.unlock();
+	d->pooled->generation.ref();
+	d->dictionaryChanged();
 }
 
 QList<QString> Checker::getSpellingSuggestions(const QString& word) const
 {
 	Q_D(const Checker);
 	QList<QString> list;
-	if(d->speller){
-		std::vector<std::string> suggestions;
-		d->speller->suggest(word.toUtf8().data(), suggestions);
-		for(std::size_t i = 0, n = suggestions.size(); i < n; ++i){
-			list.append(QString::fromUtf8(suggestions[i].c_str()));
+	if(d->dict()){
+		d->syncDictionaryGeneration();
+		if(const QList<QString>* cached = d->suggestionCache.object(word)){
+			++d->statistics.cacheHits;
+			return *cached;
 		}
+		++d->statistics.cacheMisses;
+		OperationWatch watch(d, "getSpellingSuggestions", word.length());
+		watch.startWord();
+		list = d->suggestWord(word);
+		watch.finishWord(word);
+		d->cacheSuggestions(word, list);
 	}
 	return list;
 }
 
+void Checker::prefetchSpellingSuggestions(const QList<QString>& words)
+{
+	Q_D(Checker);
+	// Prefetching does not depend on background checking, the pool has at least one thread
+	if(!d->spellingEnabled){
+		return;
+	}
+	if(!d->suggestionPrefetch){
+		d->suggestionPrefetch = new SuggestionPrefetch(this, d);
+	}
+	d->suggestionPrefetch->prefetch(words);
+}
+
+void Checker::setSlowOperationThreshold(int msecs)
+{
+	Q_D(Checker);
+	d->slowOperationThreshold = msecs;
+}
+
+int Checker::slowOperationThreshold() const
+{
+	Q_D(const Checker);
+	return d->slowOperationThreshold;
+}
+
+MemoryUsage Checker::memoryUsage() const
+{
+	Q_D(const Checker);
+	MemoryUsage usage;
+	d->memoryUsage(usage);
+	return usage;
+}
+
+void Checker::trimCaches(qint64 maxBytes)
+{
+	Q_D(Checker);
+	d->trimCaches(maxBytes);
+	unloadUnusedDictionaries();
+}
+
+CheckerStatistics Checker::statistics() const
+{
+	Q_D(const Checker);
+	CheckerStatistics stats = d->statistics;
+	stats.pendingChecks = d->pendingChecks();
+	return stats;
+}
+
+const LatencyHistogram& Checker::lookupLatency() const
+{
+	Q_D(const Checker);
+	return d->lookupLatency;
+}
+
+void Checker::resetStatistics()
+{
+	Q_D(Checker);
+	d->statistics = CheckerStatistics();
+	d->lookupLatency.reset();
+}
+
+void Checker::setMaxWorkerThreads(int count)
+{
+	QMutexLocker locker(s_workerSettingsMutex());
+	s_workerSettings()->maxThreads = qMax(0, count);
+	locker.unlock();
+	workerPool()->setMaxThreadCount(qMax(1, count));
+}
+
+int Checker::maxWorkerThreads()
+{
+	return workerSettings().maxThreads;
+}
+
+void Checker::setWorkerPriority(int priority)
+{
+	QMutexLocker locker(s_workerSettingsMutex());
+	s_workerSettings()->priority = QThread::Priority(priority);
+}
+
+int Checker::workerPriority()
+{
+	return workerSettings().priority;
+}
+
+void Checker::setBackgroundDutyCycle(double fraction)
+{
+	QMutexLocker locker(s_workerSettingsMutex());
+	s_workerSettings()->dutyCycle = qBound(0.01, fraction, 1.0);
+}
+
+double Checker::backgroundDutyCycle()
+{
+	return workerSettings().dutyCycle;
+}
+
+bool Checker::preload(const QList<QString>& languages)
+{
+	init_globals();
+	Codetable::instance();
+	bool success = true;
+	QMutexLocker locker(enchantMutex());
+	get_enchant_broker();
+	foreach(QString lang, languages){
+		if(lang.isEmpty()){
+			lang = QLocale::system().name();
+		}
+		try{
+			// Preloaded dictionaries are never unloaded, the children are expected to use them
+			PooledDictionary* entry = pooled_dictionary(lang);
+			++entry->refs;
+			if(!entry->dict){
+				success = false;
+			}
+		}catch(const enchant::Exception& e){
+			qCWarning(qtspellDict) << "Failed to preload dictionary" << lang << ":" << e.what();
+			success = false;
+		}
+	}
+	qCDebug(qtspellDict) << "Preloaded dictionaries for" << languages;
+	return success;
+}
+
+int Checker::unloadUnusedDictionaries()
+{
+	QMutexLocker locker(enchantMutex());
+	int count = unload_unused_dictionaries();
+	qCDebug(qtspellDict) << "Unloaded" << count << "unused dictionaries";
+	return count;
+}
+
 QList<QString> Checker::getLanguageList()
 {
 	enchant::Broker* broker = get_enchant_broker();
 	QList<QString> languages;
+	QMutexLocker locker(enchantMutex());
 	broker->list_dicts(dict_describe_cb, &languages);
 	std::sort(languages.begin(), languages.end());
 	return languages;
@@ -263,7 +879,7 @@ void Checker::showContextMenu(QMenu* menu, const QPoint& pos, int wordPos)
 {
 	Q_D(Checker);
 	QAction* insertPos = menu->actions().first();
-	if(d->speller && d->spellingEnabled){
+	if(d->spellingEnabled && d->dict()){
 		QString word = getWord(wordPos);
 
 		if(!checkWord(word)) {
@@ -311,7 +927,7 @@ void Checker::showContextMenu(QMenu* menu, const QPoint& pos, int wordPos)
 		connect(action, &QAction::toggled, this, &Checker::setSpellingEnabled);
 		menu->insertAction(insertPos, action);
 	}
-	if(d->speller && d->spellingEnabled){
+	if(d->spellingEnabled && d->dict()){
 		QMenu* languagesMenu = new QMenu();
 		QActionGroup* actionGroup = new QActionGroup(languagesMenu);
 		foreach(const QString& lang, getLanguageList()){
@@ -338,7 +954,11 @@ void Checker::slotAddWord()
 {
 	int wordPos = qobject_cast<QAction*>(QObject::sender())->data().toInt();
 	int start, end;
-	addWordToDictionary(getWord(wordPos, &start, &end));
+	QString word = getWord(wordPos, &start, &end);
+	if(d_ptr->traceRecorder){
+		d_ptr->traceRecorder->recordWord("add", word, start, end);
+	}
+	addWordToDictionary(word);
 	checkSpelling(start, end);
 }
 
@@ -346,7 +966,11 @@ void Checker::slotIgnoreWord()
 {
 	int wordPos = qobject_cast<QAction*>(QObject::sender())->data().toInt();
 	int start, end;
-	ignoreWord(getWord(wordPos, &start, &end));
+	QString word = getWord(wordPos, &start, &end);
+	if(d_ptr->traceRecorder){
+		d_ptr->traceRecorder->recordWord("ignore", word, start, end);
+	}
+	ignoreWord(word);
 	checkSpelling(start, end);
 }
 
@@ -356,6 +980,9 @@ void Checker::slotReplaceWord()
 	int wordPos = action->property("wordPos").toInt();
 	int start, end;
 	getWord(wordPos, &start, &end);
+	if(d_ptr->traceRecorder){
+		d_ptr->traceRecorder->setEditCause("replace");
+	}
 	insertWord(start, end, action->property("suggestion").toString());
 }
 
@@ -364,6 +991,9 @@ void Checker::slotSetLanguage(bool checked)
 	if(checked) {
 		QAction* action = qobject_cast<QAction*>(QObject::sender());
 		QString lang = action->data().toString();
+		if(d_ptr->traceRecorder){
+			d_ptr->traceRecorder->recordWord("language", lang);
+		}
 		if(!setLanguage(lang)){
 			action->setChecked(false);
 			lang = "";
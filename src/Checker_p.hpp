@@ -20,14 +20,99 @@
 #ifndef QTSPELL_CHECKER_P_HPP
 #define QTSPELL_CHECKER_P_HPP
 
+#include "QtSpell.hpp"
+
+#include <QAtomicInt>
+#include <QCache>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QLoggingCategory>
+#include <QMutex>
 #include <QString>
+#include <QThread>
+#include <QWaitCondition>
+
+class QThreadPool;
 
 namespace enchant { class Dict; }
 
 namespace QtSpell {
 
+class SuggestionPrefetch;
+class TraceRecorder;
+
+// Debug output is disabled by default, enable with i.e. QT_LOGGING_RULES="qtspell.*.debug=true"
+Q_DECLARE_LOGGING_CATEGORY(qtspellCheck)
+Q_DECLARE_LOGGING_CATEGORY(qtspellDict)
+Q_DECLARE_LOGGING_CATEGORY(qtspellTokenize)
+Q_DECLARE_LOGGING_CATEGORY(qtspellUndo)
+
 class Checker;
 
+/**
+ * @brief The process-wide settings of the background checking workers, see
+ *        Checker::setMaxWorkerThreads.
+ */
+struct WorkerSettings {
+	int maxThreads = 0;
+	QThread::Priority priority = QThread::LowestPriority;
+	double dutyCycle = 1.0;
+};
+
+/**
+ * @brief A dictionary shared by all checkers of a language.
+ */
+struct PooledDictionary {
+	enchant::Dict* dict = nullptr;
+	// Measured when loaded, -1 if it cannot be determined on this platform
+	qint64 size = -1;
+	// The checkers using the dictionary, unused ones can be unloaded
+	int refs = 0;
+	// Incremented whenever words are added or ignored, so that every checker of
+	// the language drops the verdicts it cached before
+	QAtomicInt generation;
+};
+
+// Serializes all use of enchant, whose dictionaries are shared between checkers
+QMutex* enchantMutex();
+WorkerSettings workerSettings();
+QThreadPool* workerPool();
+
+/**
+ * @brief Base of the objects which hand work to the worker threads.
+ * @details Before fork(), the work in flight of all clients is interrupted
+ *          and waited for, and the clients stay locked until fork() returns,
+ *          so that the child neither inherits a lock held by a worker thread
+ *          nor waits for work which no thread of its own will ever finish.
+ *          Interrupted work delivers what it has done so far from the event
+ *          loop, in the parent and the child alike, and queues the rest again.
+ */
+class WorkerClient
+{
+public:
+	WorkerClient();
+	virtual ~WorkerClient();
+
+	static void drainAll();
+	static void unlockAll();
+
+protected:
+	enum StopRequest { NoStop = 0, Cancelled, Interrupted };
+
+	// Shared with the worker threads
+	QMutex m_mutex;
+	QWaitCondition m_idle;
+	int m_tasksRunning = 0;
+	// A StopRequest. Cancelled work is dropped, interrupted work is delivered
+	// as far as it got.
+	QAtomicInt m_stop;
+
+	bool stopRequested() const{ return m_stop.load() != NoStop; }
+	// Call with m_mutex held
+	void waitForTasks();
+};
+
 class CheckerPrivate
 {
 public:
@@ -36,17 +121,78 @@ public:
 
 	void init();
 	bool setLanguageInternal(const QString& newLang);
+	enchant::Dict* dict() const;
+	bool lookupWord(const QString& word, bool* correct) const;
+	QList<QString> suggestWord(const QString& word) const;
+	void reportSlowOperation(const SlowOperationInfo& info) const;
+	void cacheVerdict(const QString& word, bool correct) const;
+	void cacheSuggestions(const QString& word, const QList<QString>& suggestions) const;
+	void clearCaches() const;
+	void syncDictionaryGeneration() const;
+	virtual void dictionaryChanged() const{ clearCaches(); }
+	void trimCaches(qint64 maxBytes);
+	virtual void memoryUsage(MemoryUsage& usage) const;
+	virtual int pendingChecks() const{ return 0; }
 
 	Checker* q_ptr = nullptr;
-	enchant::Dict* speller = nullptr;
+	// Shared with the other checkers of the language, see dict()
+	PooledDictionary* pooled = nullptr;
+	// The generation of the pooled dictionary the caches were filled with
+	mutable int dictionaryGeneration = 0;
 	QString lang;
+	bool languagePending = false;
 	bool decodeCodes = false;
 	bool spellingCheckbox = false;
 	bool spellingEnabled = true;
+	int slowOperationThreshold = -1;
+
+	// Verdicts are looked up for every checked word, suggestions are evicted LRU
+	mutable QHash<QString, bool> verdictCache;
+	mutable qint64 verdictCacheBytes = 0;
+	mutable QCache<QString, QList<QString>> suggestionCache;
+	// Incremented whenever the caches are cleared, see SuggestionPrefetch
+	mutable int cacheGeneration = 0;
+	SuggestionPrefetch* suggestionPrefetch = nullptr;
+	mutable CheckerStatistics statistics;
+	mutable LatencyHistogram lookupLatency;
+	TraceRecorder* traceRecorder = nullptr;
 
 	Q_DECLARE_PUBLIC(Checker)
 };
 
+/**
+ * @brief Returns the approximate number of bytes occupied by a string.
+ */
+inline qint64 stringMemoryUsage(const QString& str)
+{
+	// QString itself plus the shared data header and the character buffer
+	return sizeof(QString) + 24 + (str.capacity() + 1) * sizeof(QChar);
+}
+
+/**
+ * @brief Times an operation for the slow operation watchdog, reporting it on
+ *        destruction if it exceeded the threshold.
+ */
+class OperationWatch
+{
+public:
+	OperationWatch(const CheckerPrivate* d, const char* operation, int rangeSize = 0);
+	~OperationWatch();
+
+	bool isActive() const{ return m_active; }
+	void setLanguage(const QString& lang){ m_info.language = lang; }
+	void setRangeSize(int rangeSize){ m_info.rangeSize = rangeSize; }
+	void startWord(){ if(m_active) m_wordTimer.start(); }
+	void finishWord(const QString& word);
+
+private:
+	const CheckerPrivate* m_d;
+	bool m_active;
+	QElapsedTimer m_timer;
+	QElapsedTimer m_wordTimer;
+	SlowOperationInfo m_info;
+};
+
 } // QtSpell
 
 #endif // QTSPELL_CHECKER_P_HPP
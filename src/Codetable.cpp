@@ -17,6 +17,7 @@
  */
 
 #include "Codetable.hpp"
+#include "Checker_p.hpp"
 #include <QCoreApplication>
 #include <QDir>
 #include <QFile>
@@ -29,6 +30,8 @@
 
 namespace QtSpell {
 
+bool Codetable::s_loaded = false;
+
 Codetable* Codetable::instance()
 {
 	static Codetable codetable;
@@ -54,8 +57,23 @@ void Codetable::lookup(const QString &language_code, QString &language_name, QSt
 	}
 }
 
+qint64 Codetable::memoryUsage() const
+{
+	qint64 usage = sizeof(Codetable);
+	const QMap<QString, QString>* tables[] = {&m_languageTable, &m_countryTable};
+	for(const QMap<QString, QString>* table : tables){
+		for(QMap<QString, QString>::const_iterator it = table->begin(), itEnd = table->end(); it != itEnd; ++it){
+			// Tree node: parent/child pointers and color plus key and value
+			usage += 3 * sizeof(void*) + stringMemoryUsage(it.key()) + stringMemoryUsage(it.value());
+		}
+	}
+	return usage;
+}
+
 Codetable::Codetable()
 {
+	s_loaded = true;
+
 #ifdef Q_OS_WIN32
 	QDir dataDir = QDir(QString("%1/../share").arg(QCoreApplication::applicationDirPath()));
 #else
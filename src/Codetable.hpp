@@ -50,7 +50,21 @@ public:
 	 */
 	void lookup(const QString& language_code, QString& language_name, QString& country_name, QString& extra) const;
 
+	/**
+	 * @brief Returns whether the codetable singleton was already created.
+	 * @return Whether the codetable tables are loaded.
+	 */
+	static bool isLoaded(){ return s_loaded; }
+
+	/**
+	 * @brief Returns the approximate memory used by the lookup tables.
+	 * @return The memory usage in bytes.
+	 */
+	qint64 memoryUsage() const;
+
 private:
+	static bool s_loaded;
+
 	typedef void (*parser_t)(const QXmlStreamReader&, QMap<QString, QString>&);
 	QMap<QString, QString> m_languageTable;
 	QMap<QString, QString> m_countryTable;
@@ -0,0 +1,131 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "EditDistance.hpp"
+
+#include <QVector>
+#include <algorithm>
+
+namespace QtSpell {
+
+EditDistance::EditDistance(QStringView word)
+	: m_word(word.toString())
+{
+	std::fill(m_asciiMasks, m_asciiMasks + 128, quint64(0));
+	if(m_word.length() > 64){
+		return;
+	}
+	for(int i = 0, n = m_word.length(); i < n; ++i){
+		ushort ch = m_word[i].unicode();
+		quint64 bit = quint64(1) << i;
+		if(ch < 128){
+			m_asciiMasks[ch] |= bit;
+			continue;
+		}
+		bool found = false;
+		for(QPair<ushort, quint64>& entry : m_otherMasks){
+			if(entry.first == ch){
+				entry.second |= bit;
+				found = true;
+				break;
+			}
+		}
+		if(!found){
+			m_otherMasks.append(qMakePair(ch, bit));
+		}
+	}
+}
+
+quint64 EditDistance::mask(ushort ch) const
+{
+	if(ch < 128){
+		return m_asciiMasks[ch];
+	}
+	for(const QPair<ushort, quint64>& entry : m_otherMasks){
+		if(entry.first == ch){
+			return entry.second;
+		}
+	}
+	return 0;
+}
+
+int EditDistance::distance(QStringView candidate) const
+{
+	int m = m_word.length();
+	if(m == 0){
+		return candidate.length();
+	}
+	if(m > 64){
+		return dynamicDistance(candidate);
+	}
+	// Hyyrö, "A bit-vector algorithm for computing Levenshtein and Damerau edit
+	// distances", 2003. Bit i of the vectors holds the vertical difference of row
+	// i of the current column. Bits above the word length collect garbage, which
+	// never reaches the bits below as carries and shifts only go upwards.
+	quint64 lastBit = quint64(1) << (m - 1);
+	quint64 vp = ~quint64(0);
+	quint64 vn = 0;
+	quint64 d0 = 0;
+	quint64 prevMask = 0;
+	int score = m;
+	for(QChar ch : candidate){
+		quint64 pm = mask(ch.unicode());
+		// Transpositions match the current character one row below the previous one
+		quint64 tr = ((~d0 & pm) << 1) & prevMask;
+		d0 = (((pm & vp) + vp) ^ vp) | pm | vn | tr;
+		quint64 hp = vn | ~(d0 | vp);
+		quint64 hn = d0 & vp;
+		if(hp & lastBit){
+			++score;
+		}else if(hn & lastBit){
+			--score;
+		}
+		hp = (hp << 1) | 1;
+		hn = hn << 1;
+		vp = hn | ~(d0 | hp);
+		vn = d0 & hp;
+		prevMask = pm;
+	}
+	return score;
+}
+
+int EditDistance::dynamicDistance(QStringView candidate) const
+{
+	int m = m_word.length();
+	int n = candidate.length();
+	// Three rows of the distance matrix, the one before last for transpositions
+	QVector<int> prev2(m + 1), prev(m + 1), cur(m + 1);
+	for(int i = 0; i <= m; ++i){
+		prev[i] = i;
+	}
+	for(int j = 1; j <= n; ++j){
+		cur[0] = j;
+		for(int i = 1; i <= m; ++i){
+			int cost = m_word[i - 1] == candidate[j - 1] ? 0 : 1;
+			cur[i] = qMin(qMin(prev[i] + 1, cur[i - 1] + 1), prev[i - 1] + cost);
+			if(i > 1 && j > 1 && m_word[i - 1] == candidate[j - 2] && m_word[i - 2] == candidate[j - 1]){
+				cur[i] = qMin(cur[i], prev2[i - 2] + 1);
+			}
+		}
+		prev2.swap(prev);
+		prev.swap(cur);
+	}
+	return prev[m];
+}
+
+} // QtSpell
@@ -0,0 +1,58 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef QTSPELL_EDITDISTANCE_HPP
+#define QTSPELL_EDITDISTANCE_HPP
+
+#include <QPair>
+#include <QString>
+#include <QStringView>
+#include <QVarLengthArray>
+
+namespace QtSpell {
+
+/**
+ * @brief Computes the edit distance between a word and many candidates,
+ *        counting insertions, deletions, substitutions and transpositions of
+ *        adjacent characters (optimal string alignment distance).
+ * @details Words of up to 64 UTF-16 code units are handled with the
+ *          bit-parallel algorithm of Hyyrö, a constant number of operations
+ *          on a 64 bit word per character of the candidate. The character
+ *          masks of the word are computed once in the constructor. Longer
+ *          words fall back to dynamic programming.
+ */
+class EditDistance
+{
+public:
+	explicit EditDistance(QStringView word);
+
+	int distance(QStringView candidate) const;
+
+private:
+	QString m_word;
+	quint64 m_asciiMasks[128];
+	QVarLengthArray<QPair<ushort, quint64>, 16> m_otherMasks;
+
+	quint64 mask(ushort ch) const;
+	int dynamicDistance(QStringView candidate) const;
+};
+
+} // QtSpell
+
+#endif // QTSPELL_EDITDISTANCE_HPP
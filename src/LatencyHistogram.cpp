@@ -0,0 +1,161 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "QtSpell.hpp"
+
+#include <QtAlgorithms>
+#include <cmath>
+#include <cstring>
+
+namespace QtSpell {
+
+class LatencyHistogramPrivate
+{
+public:
+	static const int SubBucketBits = 5;
+	static const int SubBucketCount = 1 << SubBucketBits;
+	static const int MaxExponent = 37;
+	static const int BucketCount = SubBucketCount * (MaxExponent - SubBucketBits + 2);
+
+	quint32 buckets[BucketCount];
+	quint64 count;
+	qint64 sum;
+	qint64 max;
+
+	static int bucketIndex(qint64 value);
+	static qint64 bucketUpperBound(int index);
+};
+
+int LatencyHistogramPrivate::bucketIndex(qint64 value)
+{
+	// Values below SubBucketCount get an exact bucket each
+	if(value < SubBucketCount){
+		return int(value);
+	}
+	int exponent = 63 - qCountLeadingZeroBits(quint64(value));
+	if(exponent > MaxExponent){
+		return BucketCount - 1;
+	}
+	// The SubBucketBits bits following the most significant one select the sub-bucket
+	int subBucket = int(value >> (exponent - SubBucketBits)) & (SubBucketCount - 1);
+	return SubBucketCount * (exponent - SubBucketBits + 1) + subBucket;
+}
+
+qint64 LatencyHistogramPrivate::bucketUpperBound(int index)
+{
+	if(index < SubBucketCount){
+		return index;
+	}
+	int shift = index / SubBucketCount - 1;
+	qint64 subBucket = index % SubBucketCount;
+	return ((SubBucketCount + subBucket + 1) << shift) - 1;
+}
+
+LatencyHistogram::LatencyHistogram()
+	: d_ptr(new LatencyHistogramPrivate)
+{
+	reset();
+}
+
+LatencyHistogram::LatencyHistogram(const LatencyHistogram& other)
+	: d_ptr(new LatencyHistogramPrivate(*other.d_ptr))
+{
+}
+
+LatencyHistogram::~LatencyHistogram()
+{
+	delete d_ptr;
+}
+
+LatencyHistogram& LatencyHistogram::operator=(const LatencyHistogram& other)
+{
+	*d_ptr = *other.d_ptr;
+	return *this;
+}
+
+void LatencyHistogram::reset()
+{
+	Q_D(LatencyHistogram);
+	std::memset(d->buckets, 0, sizeof(d->buckets));
+	d->count = 0;
+	d->sum = 0;
+	d->max = 0;
+}
+
+void LatencyHistogram::record(qint64 usecs)
+{
+	Q_D(LatencyHistogram);
+	usecs = qMax(Q_INT64_C(0), usecs);
+	++d->buckets[LatencyHistogramPrivate::bucketIndex(usecs)];
+	++d->count;
+	d->sum += usecs;
+	d->max = qMax(d->max, usecs);
+}
+
+quint64 LatencyHistogram::count() const
+{
+	Q_D(const LatencyHistogram);
+	return d->count;
+}
+
+qint64 LatencyHistogram::max() const
+{
+	Q_D(const LatencyHistogram);
+	return d->max;
+}
+
+qint64 LatencyHistogram::sum() const
+{
+	Q_D(const LatencyHistogram);
+	return d->sum;
+}
+
+qint64 LatencyHistogram::percentile(double percentile) const
+{
+	Q_D(const LatencyHistogram);
+	if(d->count == 0){
+		return 0;
+	}
+	percentile = qBound(0., percentile, 100.);
+	quint64 target = qMax(Q_UINT64_C(1), quint64(std::ceil(percentile / 100. * d->count)));
+	quint64 seen = 0;
+	for(int i = 0; i < LatencyHistogramPrivate::BucketCount; ++i){
+		seen += d->buckets[i];
+		if(seen >= target){
+			return qMin(LatencyHistogramPrivate::bucketUpperBound(i), d->max);
+		}
+	}
+	return d->max;
+}
+
+quint64 LatencyHistogram::countAtOrBelow(qint64 usecs) const
+{
+	Q_D(const LatencyHistogram);
+	quint64 count = 0;
+	for(int i = 0; i < LatencyHistogramPrivate::BucketCount && LatencyHistogramPrivate::bucketUpperBound(i) <= usecs; ++i){
+		count += d->buckets[i];
+	}
+	return count;
+}
+
+qint64 LatencyHistogram::bucketBound(qint64 usecs)
+{
+	return LatencyHistogramPrivate::bucketUpperBound(LatencyHistogramPrivate::bucketIndex(qMax(Q_INT64_C(0), usecs)));
+}
+
+} // QtSpell
@@ -0,0 +1,348 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "QtSpell.hpp"
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QPointer>
+#include <QSaveFile>
+#include <QTimer>
+#include <functional>
+#ifdef QTSPELL_HAVE_NETWORK
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+#endif
+
+namespace QtSpell {
+
+// Histogram bucket bounds in microseconds, exported in seconds. Each is moved up to the
+// bound of the LatencyHistogram bucket holding it, so that the exported counts are exact.
+static const qint64 LATENCY_BUCKETS[] = {
+	100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000
+};
+
+// Minimum interval between rate samples, so that frequent scrapes don't produce noise
+static const qint64 RATE_SAMPLE_MSECS = 1000;
+
+// Maximum size of a request header, larger requests are dropped
+static const int MAX_REQUEST_BYTES = 8192;
+
+struct ExportedChecker {
+	QPointer<Checker> checker;
+	QString instance;
+	quint64 lastCheckCount = 0;
+	quint64 lastWordCount = 0;
+	QElapsedTimer lastSample;
+	double checksPerSecond = 0;
+	double wordsPerSecond = 0;
+};
+
+class MetricsExporterPrivate
+{
+public:
+	mutable QList<ExportedChecker> checkers;
+	QString filename;
+	QTimer fileTimer;
+#ifdef QTSPELL_HAVE_NETWORK
+	QLocalServer* localServer = nullptr;
+	QTcpServer* tcpServer = nullptr;
+#endif
+
+	void updateRates() const;
+};
+
+void MetricsExporterPrivate::updateRates() const
+{
+	for(ExportedChecker& entry : checkers){
+		if(!entry.checker){
+			continue;
+		}
+		CheckerStatistics stats = entry.checker->statistics();
+		if(!entry.lastSample.isValid() || stats.checkCount < entry.lastCheckCount){
+			// First sample or the statistics were reset
+			entry.lastSample.start();
+		}else if(entry.lastSample.elapsed() >= RATE_SAMPLE_MSECS){
+			double seconds = entry.lastSample.restart() / 1000.;
+			entry.checksPerSecond = (stats.checkCount - entry.lastCheckCount) / seconds;
+			entry.wordsPerSecond = (stats.wordsChecked - entry.lastWordCount) / seconds;
+		}else{
+			continue;
+		}
+		entry.lastCheckCount = stats.checkCount;
+		entry.lastWordCount = stats.wordsChecked;
+	}
+}
+
+static QString escape_label(QString value)
+{
+	return value.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+}
+
+static QString format_value(double value)
+{
+	return QString::number(value, 'g', 15);
+}
+
+MetricsExporter::MetricsExporter(QObject* parent)
+	: QObject(parent), d_ptr(new MetricsExporterPrivate)
+{
+	Q_D(MetricsExporter);
+	connect(&d->fileTimer, &QTimer::timeout, this, &MetricsExporter::slotWriteFile);
+}
+
+MetricsExporter::~MetricsExporter()
+{
+	delete d_ptr;
+}
+
+void MetricsExporter::addChecker(Checker* checker, const QString& instance)
+{
+	Q_D(MetricsExporter);
+	removeChecker(checker);
+	ExportedChecker entry;
+	entry.checker = checker;
+	entry.instance = instance;
+	d->checkers.append(entry);
+}
+
+void MetricsExporter::removeChecker(Checker* checker)
+{
+	Q_D(MetricsExporter);
+	for(int i = d->checkers.size() - 1; i >= 0; --i){
+		if(!d->checkers[i].checker || d->checkers[i].checker == checker){
+			d->checkers.removeAt(i);
+		}
+	}
+}
+
+bool MetricsExporter::setOutputFile(const QString& filename, int intervalMsecs)
+{
+	Q_D(MetricsExporter);
+	d->filename = filename;
+	d->fileTimer.stop();
+	if(filename.isEmpty()){
+		return true;
+	}
+	d->fileTimer.start(qMax(100, intervalMsecs));
+	QSaveFile file(filename);
+	if(!file.open(QIODevice::WriteOnly)){
+		return false;
+	}
+	file.write(metrics().toUtf8());
+	return file.commit();
+}
+
+void MetricsExporter::slotWriteFile()
+{
+	Q_D(MetricsExporter);
+	QSaveFile file(d->filename);
+	if(file.open(QIODevice::WriteOnly)){
+		file.write(metrics().toUtf8());
+		file.commit();
+	}
+}
+
+bool MetricsExporter::listenLocal(const QString& name)
+{
+#ifdef QTSPELL_HAVE_NETWORK
+	Q_D(MetricsExporter);
+	delete d->localServer;
+	d->localServer = new QLocalServer(this);
+	connect(d->localServer, &QLocalServer::newConnection, this, &MetricsExporter::slotNewConnection);
+	QLocalServer::removeServer(name);
+	return d->localServer->listen(name);
+#else
+	Q_UNUSED(name);
+	return false;
+#endif
+}
+
+bool MetricsExporter::listenLoopback(quint16 port)
+{
+#ifdef QTSPELL_HAVE_NETWORK
+	Q_D(MetricsExporter);
+	delete d->tcpServer;
+	d->tcpServer = new QTcpServer(this);
+	connect(d->tcpServer, &QTcpServer::newConnection, this, &MetricsExporter::slotNewConnection);
+	return d->tcpServer->listen(QHostAddress::LocalHost, port);
+#else
+	Q_UNUSED(port);
+	return false;
+#endif
+}
+
+quint16 MetricsExporter::serverPort() const
+{
+#ifdef QTSPELL_HAVE_NETWORK
+	Q_D(const MetricsExporter);
+	return d->tcpServer && d->tcpServer->isListening() ? d->tcpServer->serverPort() : 0;
+#else
+	return 0;
+#endif
+}
+
+void MetricsExporter::slotNewConnection()
+{
+#ifdef QTSPELL_HAVE_NETWORK
+	Q_D(MetricsExporter);
+	QList<QPair<QIODevice*, std::function<void()>>> sockets;
+	while(d->localServer && d->localServer->hasPendingConnections()){
+		QLocalSocket* socket = d->localServer->nextPendingConnection();
+		connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+		sockets.append(qMakePair(static_cast<QIODevice*>(socket), std::function<void()>([socket]{ socket->disconnectFromServer(); })));
+	}
+	while(d->tcpServer && d->tcpServer->hasPendingConnections()){
+		QTcpSocket* socket = d->tcpServer->nextPendingConnection();
+		connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+		sockets.append(qMakePair(static_cast<QIODevice*>(socket), std::function<void()>([socket]{ socket->disconnectFromHost(); })));
+	}
+	for(const auto& pair : sockets){
+		QIODevice* socket = pair.first;
+		std::function<void()> close = pair.second;
+		connect(socket, &QIODevice::readyRead, this, [this, socket, close]{
+			// Answer any request once its header is complete, the path is irrelevant
+			QByteArray request = socket->property("request").toByteArray();
+			request += socket->read(MAX_REQUEST_BYTES + 1 - request.size());
+			if(!request.contains("\r\n\r\n") && !request.contains("\n\n")){
+				if(request.size() > MAX_REQUEST_BYTES){
+					// Not a scrape, don't let the peer grow the buffer any further
+					socket->setProperty("request", QVariant());
+					close();
+				}else{
+					socket->setProperty("request", request);
+				}
+				return;
+			}
+			QByteArray body = metrics().toUtf8();
+			socket->write("HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n");
+			socket->write("Content-Length: " + QByteArray::number(body.size()) + "\r\n\r\n");
+			socket->write(body);
+			close();
+		});
+	}
+#endif
+}
+
+QString MetricsExporter::metrics() const
+{
+	Q_D(const MetricsExporter);
+	d->updateRates();
+
+	struct Sample {
+		QString instance;
+		const Checker* checker;
+		const ExportedChecker* entry;
+		CheckerStatistics stats;
+		MemoryUsage memory;
+	};
+	QList<Sample> samples;
+	for(const ExportedChecker& entry : d->checkers){
+		if(entry.checker){
+			samples.append({escape_label(entry.instance), entry.checker, &entry, entry.checker->statistics(), entry.checker->memoryUsage()});
+		}
+	}
+
+	QString out;
+	auto header = [&out](const char* name, const char* type, const char* help){
+		out += QString("# HELP %1 %2\n# TYPE %1 %3\n").arg(QString(name), QString(help), QString(type));
+	};
+	auto metric = [&](const char* name, const char* type, const char* help, const std::function<double(const Sample&)>& value){
+		header(name, type, help);
+		for(const Sample& sample : samples){
+			out += QString("%1{instance=\"%2\"} %3\n").arg(QString(name), sample.instance, format_value(value(sample)));
+		}
+	};
+	auto histogram = [&](const char* name, const char* help, const std::function<const LatencyHistogram*(const Sample&)>& get){
+		header(name, "histogram", help);
+		for(const Sample& sample : samples){
+			const LatencyHistogram* latency = get(sample);
+			if(!latency){
+				continue;
+			}
+			for(qint64 bound : LATENCY_BUCKETS){
+				bound = LatencyHistogram::bucketBound(bound);
+				out += QString("%1_bucket{instance=\"%2\",le=\"%3\"} %4\n").arg(QString(name), sample.instance, format_value(bound / 1e6), QString::number(latency->countAtOrBelow(bound)));
+			}
+			out += QString("%1_bucket{instance=\"%2\",le=\"+Inf\"} %3\n").arg(QString(name), sample.instance, QString::number(latency->count()));
+			out += QString("%1_sum{instance=\"%2\"} %3\n").arg(QString(name), sample.instance, format_value(latency->sum() / 1e6));
+			out += QString("%1_count{instance=\"%2\"} %3\n").arg(QString(name), sample.instance, QString::number(latency->count()));
+		}
+	};
+
+	metric("qtspell_checks_total", "counter", "Number of spell check runs.",
+		[](const Sample& s){ return double(s.stats.checkCount); });
+	metric("qtspell_checks_per_second", "gauge", "Spell check runs per second since the previous sample.",
+		[](const Sample& s){ return s.entry->checksPerSecond; });
+	metric("qtspell_check_seconds_total", "counter", "Time spent in spell check runs.",
+		[](const Sample& s){ return s.stats.totalCheckUsecs / 1e6; });
+	metric("qtspell_words_checked_total", "counter", "Number of words checked.",
+		[](const Sample& s){ return double(s.stats.wordsChecked); });
+	metric("qtspell_words_per_second", "gauge", "Words checked per second since the previous sample.",
+		[](const Sample& s){ return s.entry->wordsPerSecond; });
+	metric("qtspell_cache_hits_total", "counter", "Number of lookups served from the cache.",
+		[](const Sample& s){ return double(s.stats.cacheHits); });
+	metric("qtspell_cache_misses_total", "counter", "Number of lookups passed to the dictionary.",
+		[](const Sample& s){ return double(s.stats.cacheMisses); });
+	metric("qtspell_cache_hit_ratio", "gauge", "Fraction of lookups served from the cache.",
+		[](const Sample& s){ return s.stats.cacheHitRate(); });
+	metric("qtspell_pending_checks", "gauge", "Number of scheduled checks and deferred blocks.",
+		[](const Sample& s){ return double(s.stats.pendingChecks); });
+
+	header("qtspell_memory_bytes", "gauge", "Estimated memory usage per component.");
+	for(const Sample& sample : samples){
+		const QPair<const char*, qint64> components[] = {
+			qMakePair("verdict_cache", sample.memory.verdictCache),
+			qMakePair("suggestion_cache", sample.memory.suggestionCache),
+			qMakePair("undo_stack", sample.memory.undoStack),
+			qMakePair("document_indexes", sample.memory.documentIndexes)
+		};
+		for(const auto& component : components){
+			out += QString("qtspell_memory_bytes{instance=\"%1\",component=\"%2\"} %3\n").arg(sample.instance, QString(component.first), QString::number(component.second));
+		}
+	}
+
+	// Dictionaries and code tables are shared by all checkers, so they are exported once
+	header("qtspell_shared_memory_bytes", "gauge", "Estimated memory usage of the data shared by all checkers.");
+	if(!samples.isEmpty()){
+		const QPair<const char*, qint64> components[] = {
+			qMakePair("dictionaries", samples.first().memory.dictionaries),
+			qMakePair("codetable", samples.first().memory.codetable)
+		};
+		for(const auto& component : components){
+			// Dictionary sizes are unknown without a measurable heap
+			if(component.second >= 0){
+				out += QString("qtspell_shared_memory_bytes{component=\"%1\"} %2\n").arg(QString(component.first), QString::number(component.second));
+			}
+		}
+	}
+
+	histogram("qtspell_lookup_latency_seconds", "Latency of dictionary lookups not served from the cache.",
+		[](const Sample& s){ return &s.checker->lookupLatency(); });
+	histogram("qtspell_keystroke_latency_seconds", "Latency of checking the range affected by an edit.",
+		[](const Sample& s) -> const LatencyHistogram* {
+			const TextEditChecker* textEditChecker = qobject_cast<const TextEditChecker*>(s.checker);
+			return textEditChecker ? &textEditChecker->keystrokeLatency() : nullptr;
+		});
+	return out;
+}
+
+} // QtSpell
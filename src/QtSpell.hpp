@@ -22,11 +22,15 @@
 #include "QtSpellExport.hpp"
 
 #include <QObject>
+#include <QPair>
 
+class QIODevice;
 class QMenu;
 class QPlainTextEdit;
 class QPoint;
+class QRectF;
 class QTextEdit;
+class QWidget;
 
 /**
  * @brief QtSpell namespace
@@ -34,6 +38,8 @@ class QTextEdit;
 namespace QtSpell {
 
 class CheckerPrivate;
+class LatencyHistogramPrivate;
+class MetricsExporterPrivate;
 class TextEditCheckerPrivate;
 
 /**
@@ -43,6 +49,261 @@ bool QTSPELL_API checkLanguageInstalled(const QString& lang);
 
 ///////////////////////////////////////////////////////////////////////////////
 
+/**
+ * @brief A fixed-memory histogram of latencies in microseconds.
+ * @details Values are sorted into power-of-two ranges which are each split
+ *          into 32 linear sub-buckets, as in HDR histograms. Percentiles are
+ *          thereby accurate to about 3% from one microsecond up to several
+ *          hours, while the memory footprint stays constant.
+ */
+class QTSPELL_API LatencyHistogram
+{
+public:
+	/**
+	 * @brief LatencyHistogram object constructor.
+	 */
+	LatencyHistogram();
+
+	/**
+	 * @brief LatencyHistogram copy constructor.
+	 * @param other The histogram to copy.
+	 */
+	LatencyHistogram(const LatencyHistogram& other);
+
+	/**
+	 * @brief LatencyHistogram object destructor.
+	 */
+	~LatencyHistogram();
+
+	/**
+	 * @brief LatencyHistogram assignment operator.
+	 * @param other The histogram to copy.
+	 * @return This histogram.
+	 */
+	LatencyHistogram& operator=(const LatencyHistogram& other);
+
+	/**
+	 * @brief Record a value.
+	 * @param usecs The latency in microseconds.
+	 */
+	void record(qint64 usecs);
+
+	/**
+	 * @brief Remove all recorded values.
+	 */
+	void reset();
+
+	/**
+	 * @brief Returns the number of recorded values.
+	 * @return The number of recorded values.
+	 */
+	quint64 count() const;
+
+	/**
+	 * @brief Returns the largest recorded value.
+	 * @return The largest recorded value in microseconds, 0 if empty.
+	 */
+	qint64 max() const;
+
+	/**
+	 * @brief Returns the sum of all recorded values.
+	 * @return The sum of all recorded values in microseconds.
+	 */
+	qint64 sum() const;
+
+	/**
+	 * @brief Returns the value below which the specified percentage of the
+	 *        recorded values lie.
+	 * @param percentile The percentile, between 0 and 100 (i.e. 50 or 99).
+	 * @return The percentile value in microseconds, 0 if empty.
+	 */
+	qint64 percentile(double percentile) const;
+
+	/**
+	 * @brief Returns the number of recorded values which are at most the
+	 *        specified value, at the resolution of the histogram buckets.
+	 * @param usecs The upper bound in microseconds.
+	 * @return The number of values known to be at most usecs.
+	 */
+	quint64 countAtOrBelow(qint64 usecs) const;
+
+	/**
+	 * @brief Returns the upper bound of the bucket holding the specified
+	 *        value, i.e. the nearest bound at or above it for which
+	 *        countAtOrBelow is exact.
+	 * @param usecs The value in microseconds.
+	 * @return The bucket bound in microseconds.
+	 */
+	static qint64 bucketBound(qint64 usecs);
+
+private:
+	LatencyHistogramPrivate* d_ptr;
+	Q_DECLARE_PRIVATE(LatencyHistogram)
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Diagnostics about an operation which exceeded the slow operation
+ *        threshold, see QtSpell::Checker::setSlowOperationThreshold.
+ */
+struct QTSPELL_API SlowOperationInfo
+{
+	/** @brief The operation, i.e. "checkSpelling" or "loadDictionary". */
+	QString operation;
+	/** @brief The spelling language in use. */
+	QString language;
+	/** @brief The duration of the operation in microseconds. */
+	qint64 elapsedUsecs = 0;
+	/** @brief The number of characters processed by the operation. */
+	int rangeSize = 0;
+	/** @brief The number of words looked up by the operation. */
+	int wordCount = 0;
+	/** @brief The word whose lookup took longest. */
+	QString slowestWord;
+	/** @brief The duration of the lookup of slowestWord in microseconds. */
+	qint64 slowestWordUsecs = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Approximate memory usage of the checker subsystems in bytes, see
+ *        QtSpell::Checker::memoryUsage.
+ */
+struct QTSPELL_API MemoryUsage
+{
+	/**
+	 * @brief All loaded dictionaries, shared by all checkers, -1 if it cannot
+	 *        be determined on this platform.
+	 * @note The size of a dictionary is the growth of the process heap while
+	 *       it was loaded. Allocations of other threads during the load are
+	 *       counted as well, so take the value as a rough estimate only.
+	 */
+	qint64 dictionaries = 0;
+	/** @brief The cache of spell checking verdicts. */
+	qint64 verdictCache = 0;
+	/** @brief The cache of spelling suggestions. */
+	qint64 suggestionCache = 0;
+	/** @brief The text stored in the undo/redo stacks. */
+	qint64 undoStack = 0;
+	/** @brief The bookkeeping kept per checked document. */
+	qint64 documentIndexes = 0;
+	/** @brief The language and country code tables, shared by all checkers. */
+	qint64 codetable = 0;
+
+	/**
+	 * @brief Returns the sum of all known subsystem usages.
+	 * @return The total in bytes.
+	 */
+	qint64 total() const;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Activity counters of a checker, see QtSpell::Checker::statistics.
+ */
+struct QTSPELL_API CheckerStatistics
+{
+	/** @brief The number of checkSpelling runs. */
+	quint64 checkCount = 0;
+	/** @brief The duration of the last checkSpelling run in microseconds. */
+	qint64 lastCheckUsecs = 0;
+	/** @brief The total duration of all checkSpelling runs in microseconds. */
+	qint64 totalCheckUsecs = 0;
+	/** @brief The number of characters covered by all checkSpelling runs. */
+	quint64 charactersChecked = 0;
+	/** @brief The number of words passed to checkWord. */
+	quint64 wordsChecked = 0;
+	/** @brief The number of verdict and suggestion lookups served from the cache. */
+	quint64 cacheHits = 0;
+	/** @brief The number of verdict and suggestion lookups passed to the dictionary. */
+	quint64 cacheMisses = 0;
+	/** @brief The number of undo and redo steps performed. */
+	quint64 undoRedoSteps = 0;
+	/** @brief The number of characters inserted and removed by undo and redo steps. */
+	quint64 undoRedoCharacters = 0;
+	/** @brief The number of pending checks, i.e. scheduled checks and deferred blocks. */
+	int pendingChecks = 0;
+
+	/**
+	 * @brief Returns the fraction of lookups served from the cache.
+	 * @return The cache hit rate between 0 and 1.
+	 */
+	double cacheHitRate() const;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Word counts of a document, see QtSpell::TextEditChecker::textStatistics.
+ */
+struct QTSPELL_API TextStatistics
+{
+	/** @brief The number of words. */
+	int words = 0;
+	/** @brief The number of distinct words, ignoring case. */
+	int uniqueWords = 0;
+	/** @brief The number of characters, excluding paragraph separators. */
+	int characters = 0;
+	/** @brief The number of paragraphs containing at least one word. */
+	int paragraphs = 0;
+
+	/**
+	 * @brief Returns the estimated reading time.
+	 * @param wordsPerMinute The reading speed.
+	 * @return The reading time in seconds.
+	 */
+	int readingTimeSecs(int wordsPerMinute = 238) const;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief A misspelled word of a document, see
+ *        QtSpell::TextEditChecker::misspellings.
+ */
+struct QTSPELL_API Misspelling
+{
+	/** @brief The start position of the word. */
+	int start = 0;
+	/** @brief The end position of the word. */
+	int end = 0;
+	/** @brief The word. */
+	QString word;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief An estimate of the misspelling rate of a document from a sample of
+ *        its paragraphs, see QtSpell::TextEditChecker::estimateQuality.
+ */
+struct QTSPELL_API QualityEstimate
+{
+	/** @brief The estimated fraction of misspelled words. */
+	double misspellingRate = 0;
+	/** @brief The lower bound of the 95% confidence interval of the rate. */
+	double lowerBound = 0;
+	/** @brief The upper bound of the 95% confidence interval of the rate. */
+	double upperBound = 1;
+	/** @brief The number of paragraphs checked. */
+	int sampledBlocks = 0;
+	/** @brief The number of paragraphs of the document. */
+	int totalBlocks = 0;
+	/** @brief The number of words checked. */
+	int sampledWords = 0;
+	/** @brief The number of misspelled words found. */
+	int sampledMisspellings = 0;
+	/** @brief Whether all paragraphs were checked, the rate is then exact. */
+	bool complete = false;
+	/** @brief The most frequent misspelled words of the sample and their counts, most frequent first. */
+	QList<QPair<QString, int>> topUnknownWords;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
 /**
  * @brief An abstract class providing spell checking support.
  */
@@ -138,6 +399,149 @@ public:
 	 */
 	QList<QString> getSpellingSuggestions(const QString& word) const;
 
+	/**
+	 * @brief Look up the spelling suggestions for misspelled words ahead of
+	 *        time, i.e. for the next steps of a spelling review.
+	 * @details The lookups run in order on the background checking worker
+	 *          threads and fill the suggestion cache, so that
+	 *          getSpellingSuggestions returns without a dictionary lookup
+	 *          once spellingSuggestionsReady was emitted for a word. With
+	 *          background checking disabled, see setMaxWorkerThreads, the
+	 *          lookups still run on a single worker thread.
+	 * @param words The misspelled words.
+	 */
+	void prefetchSpellingSuggestions(const QList<QString>& words);
+
+	/**
+	 * @brief Set the duration above which spell checking operations are
+	 *        reported as slow.
+	 * @details Covers checkSpelling, getSpellingSuggestions, setLanguage and
+	 *          the loading of dictionaries. Slow operations are logged and
+	 *          reported through the slowOperation signal.
+	 * @param msecs The threshold in milliseconds, or -1 to disable (default).
+	 */
+	void setSlowOperationThreshold(int msecs);
+
+	/**
+	 * @brief Returns the duration above which operations are reported as slow.
+	 * @return The threshold in milliseconds, or -1 if disabled.
+	 */
+	int slowOperationThreshold() const;
+
+	/**
+	 * @brief Returns the approximate memory used by the checker subsystems.
+	 * @return The memory usage.
+	 */
+	MemoryUsage memoryUsage() const;
+
+	/**
+	 * @brief Evict entries from the verdict and suggestion caches until they
+	 *        fit into the specified budget.
+	 * @details Suggestions are evicted least recently used first. The verdict
+	 *          cache is only cleared if it exceeds the budget on its own.
+	 *          Dictionaries no longer used by any checker are unloaded as
+	 *          well, see unloadUnusedDictionaries.
+	 * @param maxBytes The memory budget for the caches in bytes.
+	 */
+	void trimCaches(qint64 maxBytes);
+
+	/**
+	 * @brief Returns the activity counters of the checker.
+	 * @return The checker statistics.
+	 */
+	CheckerStatistics statistics() const;
+
+	/**
+	 * @brief Returns the latency distribution of the dictionary lookups, i.e.
+	 *        of the checkWord calls which were not served from the cache.
+	 * @return The lookup latency histogram.
+	 */
+	const LatencyHistogram& lookupLatency() const;
+
+	/**
+	 * @brief Resets the activity counters and the lookup latency of the checker.
+	 */
+	void resetStatistics();
+
+
+	/**
+	 * @brief Set the maximum number of worker threads for background checking.
+	 * @details With background checking enabled, full rechecks of large
+	 *          documents, i.e. after attaching or changing the language, are
+	 *          split into chunks: the dictionary lookups run on the worker
+	 *          threads and the underlining is applied chunk by chunk from the
+	 *          event loop, so that the application stays responsive. This is a
+	 *          process-wide setting.
+	 * @param count The maximum number of threads, 0 (the default) to check
+	 *              synchronously.
+	 */
+	static void setMaxWorkerThreads(int count);
+
+	/**
+	 * @brief Returns the maximum number of worker threads for background checking.
+	 * @return The maximum number of threads, 0 if background checking is disabled.
+	 */
+	static int maxWorkerThreads();
+
+	/**
+	 * @brief Set the priority of the background checking worker threads. This
+	 *        is a process-wide setting.
+	 * @param priority A QThread::Priority, by default QThread::LowestPriority.
+	 */
+	static void setWorkerPriority(int priority);
+
+	/**
+	 * @brief Returns the priority of the background checking worker threads.
+	 * @return The priority, a QThread::Priority.
+	 */
+	static int workerPriority();
+
+	/**
+	 * @brief Set the fraction of time background checking may keep a thread
+	 *        busy. After each chunk, the worker and the event loop pause in
+	 *        proportion to the time the chunk took. This is a process-wide
+	 *        setting.
+	 * @param fraction The duty cycle between 0.01 and 1 (the default, no pauses).
+	 */
+	static void setBackgroundDutyCycle(double fraction);
+
+	/**
+	 * @brief Returns the fraction of time background checking may keep a thread busy.
+	 * @return The duty cycle.
+	 */
+	static double backgroundDutyCycle();
+
+	/**
+	 * @brief Load the dictionaries of the specified languages, the language
+	 *        code tables and the translations now rather than on first use.
+	 * @details Meant for the master process of a forking server: children
+	 *          forked afterwards share the loaded data copy-on-write and
+	 *          find the dictionaries already loaded when they set the
+	 *          language. The locks of QtSpell are held across fork(), so
+	 *          children never inherit them in a locked state. Worker threads
+	 *          do not survive fork(), so children start their own: work the
+	 *          workers have in flight is interrupted before fork() proceeds,
+	 *          what was done is delivered in the parent and the child, and
+	 *          the rest is queued again.
+	 * @param languages The languages, an empty string for the system locale.
+	 * @return Whether all dictionaries could be loaded.
+	 * @note Call after the application object was created and before any
+	 *       worker thread has been started, i.e. before background checking
+	 *       is enabled with setMaxWorkerThreads and before suggestions are
+	 *       prefetched, since the fork handlers are installed here. Call fork() from the thread running the event
+	 *       loop. Preloaded dictionaries are never unloaded.
+	 */
+	static bool preload(const QList<QString>& languages);
+
+	/**
+	 * @brief Unload the dictionaries which are no longer used by any checker.
+	 * @details Dictionaries are shared by all checkers of a language and
+	 *          stay loaded when the last of them is destroyed or switches
+	 *          to another language, so that short-lived checkers do not
+	 *          reload them over and over.
+	 * @return The number of unloaded dictionaries.
+	 */
+	static int unloadUnusedDictionaries();
 
 	/**
 	 * @brief Requests the list of languages available for spell checking.
@@ -170,6 +574,21 @@ signals:
 	 */
 	void languageChanged(const QString& newLang);
 
+	/**
+	 * @brief This signal is emitted when an operation took longer than the
+	 *        slow operation threshold.
+	 * @param info Diagnostics about the operation.
+	 */
+	void slowOperation(const QtSpell::SlowOperationInfo& info);
+
+	/**
+	 * @brief This signal is emitted when the lookup of a word passed to
+	 *        prefetchSpellingSuggestions finished, immediately if its
+	 *        suggestions were already cached.
+	 * @param word The word.
+	 */
+	void spellingSuggestionsReady(const QString& word);
+
 protected:
 	void showContextMenu(QMenu* menu, const QPoint& pos, int wordPos);
 
@@ -215,12 +634,35 @@ private:
 
 /**
  * @brief Checker class for QTextEdit widgets.
- * @details Sample usage: @include example.hpp
+ * @details If several checkers are attached to widgets showing the same
+ *          document, i.e. in split views, the first read-write checker checks
+ *          the document and keeps the undo history on behalf of all of them,
+ *          with its language. The other checkers forward checks and undo/redo
+ *          to it and only handle the context menu of their own widget.
+ *
+ *          Sample usage: @include example.hpp
  */
 class QTSPELL_API TextEditChecker : public Checker
 {
 	Q_OBJECT
 public:
+	/**
+	 * @brief The ways in which the checker hooks into an attached widget.
+	 */
+	enum AttachMode {
+		ReadWriteMode, /**< Check on every edit, with undo/redo and context menu support (default). */
+		ReadOnlyMode,  /**< Lightweight mode for viewers, i.e. QTextBrowser: the contents are checked
+		                    once after each change, without undo/redo bookkeeping, event filter or
+		                    context menu. The misspellings found are kept in an index which serves
+		                    misspellings() without rescanning the document. */
+		AppendOnlyMode /**< Mode for log and chat views which only ever get text appended: the blocks
+		                    changed since the last check are checked in batches from the event loop,
+		                    without undo/redo bookkeeping or event filter. Blocks dropped by
+		                    QPlainTextEdit::maximumBlockCount are forgotten, the checked history is
+		                    never rescanned. */
+	};
+	Q_ENUM(AttachMode)
+
 	/**
 	 * @brief TextEditChecker object constructor.
 	 */
@@ -233,7 +675,13 @@ public:
 
 	/**
 	 * @brief Set the QTextEdit to check.
-	 * @param textEdit The QTextEdit to check, or 0 to detach.
+	 * @param textEdit The QTextEdit to check, or 0 to detach. Replaces the
+	 *        first widget only, widgets added with addTextEdit stay attached.
+	 * @note If the document of the widget is already checked by another
+	 *       checker, i.e. in split views, that checker goes on checking it
+	 *       for all views, and the context menu of this checker uses its
+	 *       language and spelling switch. The undo history of the document
+	 *       is handed over to the next checker when that one is detached.
 	 */
 	void setTextEdit(QTextEdit* textEdit);
 
@@ -243,6 +691,41 @@ public:
 	 */
 	void setTextEdit(QPlainTextEdit* textEdit);
 
+	/**
+	 * @brief Check an additional QTextEdit with this checker.
+	 * @details The first widget becomes the one set with setTextEdit. All
+	 *          widgets share the dictionary, caches and settings of this
+	 *          checker, while undo/redo, the underlines, the misspelling
+	 *          index and the word statistics are kept once per document. A
+	 *          full checkSpelling rechecks all documents. Widgets are removed
+	 *          automatically when they are destroyed.
+	 * @param textEdit The QTextEdit to check.
+	 * @note The methods taking document positions without a widget, i.e.
+	 *       misspellings() and replaceWords(), refer to the document of the
+	 *       first widget. Use the overloads taking a widget for the others.
+	 */
+	void addTextEdit(QTextEdit* textEdit);
+
+	/**
+	 * @brief Check an additional QPlainTextEdit with this checker.
+	 * @param textEdit The QPlainTextEdit to check.
+	 * @see addTextEdit(QTextEdit*)
+	 */
+	void addTextEdit(QPlainTextEdit* textEdit);
+
+	/**
+	 * @brief Stop checking a widget set with setTextEdit or addTextEdit.
+	 * @param textEdit The widget to detach.
+	 */
+	void removeTextEdit(QWidget* textEdit);
+
+	/**
+	 * @brief Returns the widgets checked by this checker.
+	 * @return The widget set with setTextEdit, if any, followed by the widgets
+	 *         added with addTextEdit.
+	 */
+	QList<QWidget*> textEdits() const;
+
 	/**
 	 * @brief Set the QTextCharFormat property identifier which marks whether
 	 *        a word ought to be spell-checked.
@@ -261,6 +744,55 @@ public:
 	 */
 	int noSpellingPropertyId() const;
 
+	/**
+	 * @brief Set how the checker hooks into the attached widget.
+	 * @param mode The attach mode, see QtSpell::TextEditChecker::AttachMode.
+	 * @note Switching to ReadOnlyMode or AppendOnlyMode disables undo/redo.
+	 *       These modes expect undo/redo of the QTextDocument itself to be
+	 *       disabled with QTextDocument::setUndoRedoEnabled(false), as
+	 *       viewers and log views have no use for it. The checker never
+	 *       discards a history the document keeps: while it is empty, the
+	 *       underlining is left out of it, otherwise each check adds an undo
+	 *       step of its own and a warning is logged once.
+	 */
+	void setAttachMode(AttachMode mode);
+
+	/**
+	 * @brief Returns how the checker hooks into the attached widget.
+	 * @return The attach mode.
+	 */
+	AttachMode attachMode() const;
+
+	/**
+	 * @brief Returns the latency of the edit handling.
+	 * @details Measures the time spent from a QTextDocument::contentsChange
+	 *          notification until the changed range is checked, including the
+	 *          undo/redo bookkeeping. Useful to monitor the typing latency.
+	 *          In AppendOnlyMode, one value is recorded per batch of appended
+	 *          text once it is checked. With a SyntaxHighlighter doing the
+	 *          checking, its spell checking pass over each block is recorded.
+	 *          The edits of all attached widgets are recorded, and those of a
+	 *          document shared with other checkers are recorded by each of
+	 *          them.
+	 * @return The edit handling latency histogram.
+	 */
+	const LatencyHistogram& keystrokeLatency() const;
+
+	/**
+	 * @brief Start recording a trace of the editing session.
+	 * @details Edits, key presses, undo/redo and spelling context menu actions
+	 *          on the first attached widget are written to the device as JSON lines
+	 *          with timestamps, starting with the current document contents.
+	 *          Traces can be replayed with the qtspell-tracereplay tool.
+	 * @param device An open, writable device.
+	 */
+	void startTraceRecording(QIODevice* device);
+
+	/**
+	 * @brief Stop recording the editing session trace.
+	 */
+	void stopTraceRecording();
+
 	void checkSpelling(int start = 0, int end = -1);
 
 	/**
@@ -269,12 +801,128 @@ public:
 	 * @note QtSpell::TextEditChecker reimplements the undo/redo functionality
 	 *       since the one provided by QTextDocument also tracks text format
 	 *       changes (i.e. underlining of spelling errors) which is undesirable.
+	 * @note Undo/redo cannot be enabled in ReadOnlyMode and AppendOnlyMode.
 	 */
 	void setUndoRedoEnabled(bool enabled);
 
+	/**
+	 * @brief Sets whether checking of invisible blocks is deferred until they
+	 *        become visible.
+	 * @param defer Whether to defer checking of invisible blocks.
+	 * @note Blocks hidden with QTextBlock::setVisible(false), i.e. folded
+	 *       regions in code and outline editors, are skipped by checkSpelling
+	 *       and checked as soon as the document layout is updated after they
+	 *       were made visible again.
+	 */
+	void setDeferInvisibleBlocks(bool defer);
+
+	/**
+	 * @brief Returns whether checking of invisible blocks is deferred until
+	 *        they become visible.
+	 * @return Whether checking of invisible blocks is deferred.
+	 */
+	bool deferInvisibleBlocks() const;
+
+	/**
+	 * @brief Sets whether word statistics of the attached document are
+	 *        maintained.
+	 * @details The statistics are kept per block and updated along with the
+	 *          checking of each edit, recounting only the changed blocks.
+	 *          textStatisticsChanged is emitted whenever the totals change.
+	 * @param enabled Whether to maintain the statistics.
+	 */
+	void setTextStatisticsEnabled(bool enabled);
+
+	/**
+	 * @brief Returns whether word statistics of the attached document are
+	 *        maintained.
+	 * @return Whether the statistics are maintained.
+	 */
+	bool textStatisticsEnabled() const;
+
+	/**
+	 * @brief Returns the word statistics of the attached documents.
+	 * @details With several widgets attached, the counts of their documents
+	 *          are summed up. Words occurring in several documents count as
+	 *          one distinct word.
+	 * @return The statistics, all zero if not enabled or not attached.
+	 */
+	TextStatistics textStatistics() const;
+
+	/**
+	 * @brief Returns the word statistics of the document of an attached widget.
+	 * @param textEdit The widget, set with setTextEdit or addTextEdit.
+	 * @return The statistics, all zero if not enabled or not attached.
+	 */
+	TextStatistics textStatistics(QWidget* textEdit) const;
+
+	/**
+	 * @brief Returns the misspelled words of the attached document.
+	 * @details Words marked with the no-spelling property are skipped, see
+	 *          setNoSpellingPropertyId.
+	 * @param start The start position within the document.
+	 * @param end The end position within the document (-1 for the end).
+	 * @return The misspellings, in document order.
+	 */
+	QList<Misspelling> misspellings(int start = 0, int end = -1) const;
+
+	/**
+	 * @brief Returns the misspelled words of the document of an attached widget.
+	 * @param textEdit The widget, set with setTextEdit or addTextEdit.
+	 * @param start The start position within the document.
+	 * @param end The end position within the document (-1 for the end).
+	 * @return The misspellings, in document order.
+	 * @see misspellings(int, int)
+	 */
+	QList<Misspelling> misspellings(QWidget* textEdit, int start = 0, int end = -1) const;
+
+	/**
+	 * @brief Replace misspelled words of the attached document, i.e. at the
+	 *        end of a spelling review.
+	 * @details The replacements are undone in a single step. Misspellings
+	 *          whose text changed since they were found are left alone.
+	 * @param replacements The misspellings and their replacements.
+	 */
+	void replaceWords(const QList<QPair<Misspelling, QString>>& replacements);
+
+	/**
+	 * @brief Replace misspelled words of the document of an attached widget.
+	 * @param textEdit The widget, set with setTextEdit or addTextEdit.
+	 * @param replacements The misspellings and their replacements.
+	 * @see replaceWords(const QList<QPair<Misspelling, QString>>&)
+	 */
+	void replaceWords(QWidget* textEdit, const QList<QPair<Misspelling, QString>>& replacements);
+
+	/**
+	 * @brief Estimate the misspelling rate of the attached document within a
+	 *        time budget, i.e. to decide whether a huge document is worth a
+	 *        full check.
+	 * @details Paragraphs are drawn at random, without replacement, and
+	 *          checked until the time budget is used up or all of them were
+	 *          checked. The confidence interval accounts for misspellings
+	 *          clustering within paragraphs. The document is not modified.
+	 * @param budgetMsecs The time budget in milliseconds.
+	 * @param topWords The maximum number of unknown words to report.
+	 * @return The estimate.
+	 */
+	QualityEstimate estimateQuality(int budgetMsecs = 100, int topWords = 10) const;
+
+	/**
+	 * @brief Estimate the misspelling rate of the document of an attached widget.
+	 * @param textEdit The widget, set with setTextEdit or addTextEdit.
+	 * @param budgetMsecs The time budget in milliseconds.
+	 * @param topWords The maximum number of unknown words to report.
+	 * @return The estimate.
+	 * @see estimateQuality(int, int)
+	 */
+	QualityEstimate estimateQuality(QWidget* textEdit, int budgetMsecs = 100, int topWords = 10) const;
+
 public slots:
 	/**
 	 * @brief Undo the last edit operation.
+	 * @details With several widgets attached, the document of the focused
+	 *          widget, or else of the first one, is affected. The same
+	 *          applies to redo and clearUndoRedo.
 	 * @note QtSpell::TextEditChecker reimplements the undo/redo functionality
 	 *       since the one provided by QTextDocument also tracks text format
 	 *       changes (i.e. underlining of spelling errors) which is undesirable.
@@ -297,6 +945,11 @@ public slots:
 	 */
 	void clearUndoRedo();
 
+	/**
+	 * @brief Clears the edit handling latency histogram.
+	 */
+	void resetKeystrokeLatency();
+
 signals:
 	/**
 	 * @brief Emitted when the undo stack changes.
@@ -316,6 +969,12 @@ signals:
 	 */
 	void redoAvailable(bool available);
 
+	/**
+	 * @brief Emitted when the word statistics of the attached document change.
+	 * @note Only emitted if enabled with setTextStatisticsEnabled.
+	 */
+	void textStatisticsChanged();
+
 private:
 	QString getWord(int pos, int* start = 0, int* end = 0) const;
 	void insertWord(int start, int end, const QString& word);
@@ -327,11 +986,105 @@ private slots:
 	void slotCheckDocumentChanged();
 	void slotDetachTextEdit();
 	void slotCheckRange(int pos, int removed, int added);
+	void slotCheckRevealedBlocks(const QRectF& rect);
+	void slotScheduledCheck();
 
 private:
 	Q_DECLARE_PRIVATE(TextEditChecker)
 };
 
+///////////////////////////////////////////////////////////////////////////////
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Exports the counters and histograms of checkers in the Prometheus
+ *        text exposition format.
+ * @details The metrics are labelled with the instance name of each checker:
+ *          checks, words and their rate, cache hits, misses and hit ratio,
+ *          pending checks, memory usage per component including dictionaries,
+ *          and the dictionary lookup and keystroke latency histograms.
+ *          They can be written to a file periodically, i.e. for the textfile
+ *          collector of the node exporter, or served over HTTP on a local
+ *          socket or loopback TCP port, if QtSpell was built with QtNetwork.
+ */
+class QTSPELL_API MetricsExporter : public QObject
+{
+	Q_OBJECT
+public:
+	/**
+	 * @brief MetricsExporter object constructor.
+	 */
+	MetricsExporter(QObject* parent = 0);
+
+	/**
+	 * @brief MetricsExporter object destructor.
+	 */
+	~MetricsExporter();
+
+	/**
+	 * @brief Export the metrics of a checker. Checkers are removed
+	 *        automatically when they are destroyed.
+	 * @param checker The checker.
+	 * @param instance The value of the instance label of its metrics.
+	 */
+	void addChecker(Checker* checker, const QString& instance);
+
+	/**
+	 * @brief Stop exporting the metrics of a checker.
+	 * @param checker The checker.
+	 */
+	void removeChecker(Checker* checker);
+
+	/**
+	 * @brief Periodically write the metrics to a file. The file is replaced
+	 *        atomically, so that readers never see a partial file.
+	 * @param filename The file name, or an empty string to stop writing.
+	 * @param intervalMsecs The interval between writes in milliseconds.
+	 * @return Whether the file could be written.
+	 */
+	bool setOutputFile(const QString& filename, int intervalMsecs = 15000);
+
+	/**
+	 * @brief Serve the metrics over HTTP on a local (Unix domain) socket.
+	 * @param name The socket name or path.
+	 * @return Whether the socket is listening, false if QtSpell was built
+	 *         without QtNetwork.
+	 */
+	bool listenLocal(const QString& name);
+
+	/**
+	 * @brief Serve the metrics over HTTP on a loopback TCP port.
+	 * @param port The port, 0 to pick a free one, see serverPort.
+	 * @return Whether the port is listening, false if QtSpell was built
+	 *         without QtNetwork.
+	 */
+	bool listenLoopback(quint16 port);
+
+	/**
+	 * @brief Returns the loopback TCP port the metrics are served on.
+	 * @return The port, 0 if not listening.
+	 */
+	quint16 serverPort() const;
+
+	/**
+	 * @brief Returns the current metrics.
+	 * @return The metrics in the Prometheus text exposition format.
+	 */
+	QString metrics() const;
+
+private slots:
+	void slotWriteFile();
+	void slotNewConnection();
+
+private:
+	MetricsExporterPrivate* d_ptr;
+	Q_DECLARE_PRIVATE(MetricsExporter)
+};
+
 } // QtSpell
 
+Q_DECLARE_METATYPE(QtSpell::SlowOperationInfo)
+
 #endif // QTSPELL_HPP
@@ -0,0 +1,364 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ReviewDialog.hpp"
+
+#include <QDialogButtonBox>
+#include <QGridLayout>
+#include <QHash>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QPlainTextEdit>
+#include <QPointer>
+#include <QPushButton>
+#include <QSet>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTextEdit>
+
+namespace QtSpell {
+
+// Number of upcoming distinct words whose suggestions are looked up ahead
+static const int PREFETCH_WORDS = 8;
+// Characters shown on either side of the misspelled word
+static const int CONTEXT_CHARS = 40;
+
+class ReviewDialogPrivate
+{
+public:
+	QPointer<TextEditChecker> checker;
+	QList<Misspelling> misspellings;
+	int current = -1;
+	QList<QPair<Misspelling, QString>> replacements;
+	QHash<QString, QString> changeAll;
+	QSet<QString> skipped;
+	// Words passed to the prefetch, and those of them not reported ready yet
+	QSet<QString> prefetched;
+	QSet<QString> pending;
+	bool recheck = false;
+
+	QLabel* contextLabel;
+	QLineEdit* changeEdit;
+	QListWidget* suggestionList;
+	QLabel* progressLabel;
+	QList<QPushButton*> wordButtons;
+
+	QTextDocument* document() const;
+	void selectWord(const Misspelling& misspelling) const;
+	void advance();
+	void prefetch();
+	void showSuggestions();
+};
+
+QTextDocument* ReviewDialogPrivate::document() const
+{
+	QWidget* widget = checker ? checker->textEdits().value(0) : nullptr;
+	if(QTextEdit* textEdit = qobject_cast<QTextEdit*>(widget)){
+		return textEdit->document();
+	}else if(QPlainTextEdit* plainTextEdit = qobject_cast<QPlainTextEdit*>(widget)){
+		return plainTextEdit->document();
+	}
+	return nullptr;
+}
+
+void ReviewDialogPrivate::selectWord(const Misspelling& misspelling) const
+{
+	QWidget* widget = checker ? checker->textEdits().value(0) : nullptr;
+	if(QTextEdit* textEdit = qobject_cast<QTextEdit*>(widget)){
+		QTextCursor cursor = textEdit->textCursor();
+		cursor.setPosition(misspelling.start);
+		cursor.setPosition(misspelling.end, QTextCursor::KeepAnchor);
+		textEdit->setTextCursor(cursor);
+		textEdit->ensureCursorVisible();
+	}else if(QPlainTextEdit* plainTextEdit = qobject_cast<QPlainTextEdit*>(widget)){
+		QTextCursor cursor = plainTextEdit->textCursor();
+		cursor.setPosition(misspelling.start);
+		cursor.setPosition(misspelling.end, QTextCursor::KeepAnchor);
+		plainTextEdit->setTextCursor(cursor);
+		plainTextEdit->ensureCursorVisible();
+	}
+}
+
+void ReviewDialogPrivate::advance()
+{
+	// Skip words which were ignored or added, and apply "Change all" choices
+	for(++current; current < misspellings.size(); ++current){
+		const Misspelling& misspelling = misspellings[current];
+		if(changeAll.contains(misspelling.word)){
+			replacements.append(qMakePair(misspelling, changeAll.value(misspelling.word)));
+		}else if(!skipped.contains(misspelling.word)){
+			break;
+		}
+	}
+	if(current >= misspellings.size()){
+		contextLabel->setText(ReviewDialog::tr("The spelling review is complete."));
+		progressLabel->setText(ReviewDialog::tr("%n replacement(s) to apply", "", replacements.size()));
+		changeEdit->clear();
+		changeEdit->setEnabled(false);
+		suggestionList->clear();
+		suggestionList->setEnabled(false);
+		for(QPushButton* button : wordButtons){
+			button->setEnabled(false);
+		}
+		return;
+	}
+	const Misspelling& misspelling = misspellings[current];
+	QString context = misspelling.word.toHtmlEscaped();
+	if(QTextDocument* doc = document()){
+		QTextBlock block = doc->findBlock(misspelling.start);
+		QString text = block.text();
+		int pos = misspelling.start - block.position();
+		int before = qMin(pos, CONTEXT_CHARS);
+		int after = pos + misspelling.word.length();
+		context = text.mid(pos - before, before).toHtmlEscaped() + "<b>" + context + "</b>" + text.mid(after, CONTEXT_CHARS).toHtmlEscaped();
+		if(before < pos){
+			context.prepend("...");
+		}
+		if(after + CONTEXT_CHARS < text.length()){
+			context.append("...");
+		}
+		selectWord(misspelling);
+	}
+	contextLabel->setText(context);
+	progressLabel->setText(ReviewDialog::tr("Misspelling %1 of %2").arg(current + 1).arg(misspellings.size()));
+	prefetch();
+	showSuggestions();
+}
+
+void ReviewDialogPrivate::prefetch()
+{
+	if(!checker){
+		return;
+	}
+	QList<QString> words;
+	QSet<QString> seen;
+	for(int i = current; i < misspellings.size() && seen.size() < PREFETCH_WORDS; ++i){
+		const QString& word = misspellings[i].word;
+		if(skipped.contains(word) || changeAll.contains(word) || seen.contains(word)){
+			continue;
+		}
+		seen.insert(word);
+		if(!prefetched.contains(word)){
+			prefetched.insert(word);
+			pending.insert(word);
+			words.append(word);
+		}
+	}
+	if(!words.isEmpty()){
+		checker->prefetchSpellingSuggestions(words);
+	}
+}
+
+void ReviewDialogPrivate::showSuggestions()
+{
+	const QString& word = misspellings[current].word;
+	suggestionList->clear();
+	if(!checker){
+		changeEdit->setText(word);
+		return;
+	}
+	if(pending.contains(word)){
+		// Shown once slotSuggestionsReady reports the word
+		QListWidgetItem* item = new QListWidgetItem(ReviewDialog::tr("(Looking up suggestions...)"), suggestionList);
+		item->setFlags(Qt::NoItemFlags);
+		changeEdit->setText(word);
+		return;
+	}
+	QList<QString> suggestions = checker->getSpellingSuggestions(word);
+	if(suggestions.isEmpty()){
+		QListWidgetItem* item = new QListWidgetItem(ReviewDialog::tr("(No suggestions)"), suggestionList);
+		item->setFlags(Qt::NoItemFlags);
+		changeEdit->setText(word);
+		return;
+	}
+	suggestionList->addItems(suggestions);
+	suggestionList->setCurrentRow(0);
+	changeEdit->setText(suggestions.first());
+}
+
+ReviewDialog::ReviewDialog(TextEditChecker* checker, QWidget* parent)
+	: QDialog(parent)
+	, d_ptr(new ReviewDialogPrivate)
+{
+	Q_D(ReviewDialog);
+	d->checker = checker;
+	setWindowTitle(tr("Check Spelling"));
+
+	d->contextLabel = new QLabel(this);
+	d->contextLabel->setTextFormat(Qt::RichText);
+	d->contextLabel->setWordWrap(true);
+	d->changeEdit = new QLineEdit(this);
+	d->suggestionList = new QListWidget(this);
+	d->progressLabel = new QLabel(this);
+
+	QPushButton* ignoreButton = new QPushButton(tr("Ignore"), this);
+	QPushButton* ignoreAllButton = new QPushButton(tr("Ignore All"), this);
+	QPushButton* addButton = new QPushButton(tr("Add to Dictionary"), this);
+	QPushButton* changeButton = new QPushButton(tr("Change"), this);
+	QPushButton* changeAllButton = new QPushButton(tr("Change All"), this);
+	changeButton->setDefault(true);
+	d->wordButtons << ignoreButton << ignoreAllButton << addButton << changeButton << changeAllButton;
+	QDialogButtonBox* buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+	buttonBox->button(QDialogButtonBox::Ok)->setText(tr("Apply Changes"));
+
+	QGridLayout* layout = new QGridLayout(this);
+	layout->addWidget(new QLabel(tr("Not in dictionary:"), this), 0, 0, 1, 2);
+	layout->addWidget(d->contextLabel, 1, 0, 3, 1);
+	layout->addWidget(ignoreButton, 1, 1);
+	layout->addWidget(ignoreAllButton, 2, 1);
+	layout->addWidget(addButton, 3, 1);
+	layout->addWidget(new QLabel(tr("Change to:"), this), 4, 0, 1, 2);
+	layout->addWidget(d->changeEdit, 5, 0);
+	layout->addWidget(changeButton, 5, 1);
+	layout->addWidget(d->suggestionList, 6, 0, 2, 1);
+	layout->addWidget(changeAllButton, 6, 1, Qt::AlignTop);
+	layout->addWidget(d->progressLabel, 8, 0);
+	layout->addWidget(buttonBox, 9, 0, 1, 2);
+	layout->setRowStretch(7, 1);
+
+	connect(ignoreButton, &QPushButton::clicked, this, &ReviewDialog::slotIgnore);
+	connect(ignoreAllButton, &QPushButton::clicked, this, &ReviewDialog::slotIgnoreAll);
+	connect(addButton, &QPushButton::clicked, this, &ReviewDialog::slotAddWord);
+	connect(changeButton, &QPushButton::clicked, this, &ReviewDialog::slotChange);
+	connect(changeAllButton, &QPushButton::clicked, this, &ReviewDialog::slotChangeAll);
+	connect(d->suggestionList, &QListWidget::currentTextChanged, this, &ReviewDialog::slotSuggestionSelected);
+	connect(d->suggestionList, &QListWidget::itemActivated, this, &ReviewDialog::slotChange);
+	connect(buttonBox, &QDialogButtonBox::accepted, this, &ReviewDialog::accept);
+	connect(buttonBox, &QDialogButtonBox::rejected, this, &ReviewDialog::reject);
+
+	if(checker){
+		connect(checker, &Checker::spellingSuggestionsReady, this, &ReviewDialog::slotSuggestionsReady);
+		d->misspellings = checker->misspellings();
+	}
+	d->advance();
+}
+
+ReviewDialog::~ReviewDialog()
+{
+	delete d_ptr;
+}
+
+int ReviewDialog::replacementCount() const
+{
+	Q_D(const ReviewDialog);
+	return d->replacements.size();
+}
+
+void ReviewDialog::done(int result)
+{
+	Q_D(ReviewDialog);
+	if(d->checker){
+		if(result == QDialog::Accepted){
+			d->checker->replaceWords(d->replacements);
+		}
+		if(d->recheck){
+			// Underlines of the words ignored or added during the review
+			d->checker->checkSpelling();
+		}
+	}
+	d->replacements.clear();
+	d->recheck = false;
+	QDialog::done(result);
+}
+
+void ReviewDialog::slotIgnore()
+{
+	Q_D(ReviewDialog);
+	if(d->current < d->misspellings.size()){
+		d->advance();
+	}
+}
+
+void ReviewDialog::slotIgnoreAll()
+{
+	Q_D(ReviewDialog);
+	if(!d->checker || d->current >= d->misspellings.size()){
+		return;
+	}
+	const QString& word = d->misspellings[d->current].word;
+	d->checker->ignoreWord(word);
+	d->skipped.insert(word);
+	// The suggestion cache was cleared
+	d->prefetched.clear();
+	d->recheck = true;
+	d->advance();
+}
+
+void ReviewDialog::slotAddWord()
+{
+	Q_D(ReviewDialog);
+	if(!d->checker || d->current >= d->misspellings.size()){
+		return;
+	}
+	const QString& word = d->misspellings[d->current].word;
+	d->checker->addWordToDictionary(word);
+	d->skipped.insert(word);
+	d->prefetched.clear();
+	d->recheck = true;
+	d->advance();
+}
+
+void ReviewDialog::slotChange()
+{
+	Q_D(ReviewDialog);
+	if(d->current >= d->misspellings.size()){
+		return;
+	}
+	const Misspelling& misspelling = d->misspellings[d->current];
+	QString replacement = d->changeEdit->text();
+	if(replacement != misspelling.word){
+		d->replacements.append(qMakePair(misspelling, replacement));
+	}
+	d->advance();
+}
+
+void ReviewDialog::slotChangeAll()
+{
+	Q_D(ReviewDialog);
+	if(d->current >= d->misspellings.size()){
+		return;
+	}
+	const Misspelling& misspelling = d->misspellings[d->current];
+	QString replacement = d->changeEdit->text();
+	if(replacement != misspelling.word){
+		d->changeAll.insert(misspelling.word, replacement);
+		d->replacements.append(qMakePair(misspelling, replacement));
+	}else{
+		d->skipped.insert(misspelling.word);
+	}
+	d->advance();
+}
+
+void ReviewDialog::slotSuggestionSelected(const QString& suggestion)
+{
+	Q_D(ReviewDialog);
+	if(!suggestion.isEmpty() && (d->suggestionList->currentItem()->flags() & Qt::ItemIsEnabled)){
+		d->changeEdit->setText(suggestion);
+	}
+}
+
+void ReviewDialog::slotSuggestionsReady(const QString& word)
+{
+	Q_D(ReviewDialog);
+	if(d->pending.remove(word) && d->current < d->misspellings.size() && d->misspellings[d->current].word == word){
+		d->showSuggestions();
+	}
+}
+
+} // QtSpell
@@ -0,0 +1,81 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef QTSPELL_REVIEWDIALOG_HPP
+#define QTSPELL_REVIEWDIALOG_HPP
+
+#include "QtSpell.hpp"
+
+#include <QDialog>
+
+namespace QtSpell {
+
+class ReviewDialogPrivate;
+
+/**
+ * @brief A dialog which steps through the misspellings of a document, as in
+ *        the spelling pass of a word processor.
+ * @details The misspellings are collected when the dialog is created. The
+ *          suggestions for the next misspellings are looked up ahead on the
+ *          worker threads while the user reviews the current one, see
+ *          Checker::prefetchSpellingSuggestions. The chosen
+ *          replacements are applied when the dialog is accepted, as a single
+ *          undo step. Ignored and added words take effect immediately.
+ */
+class QTSPELL_API ReviewDialog : public QDialog
+{
+	Q_OBJECT
+public:
+	/**
+	 * @brief ReviewDialog object constructor.
+	 * @param checker The checker whose document to review.
+	 * @param parent The parent widget.
+	 */
+	ReviewDialog(TextEditChecker* checker, QWidget* parent = 0);
+
+	/**
+	 * @brief ReviewDialog object destructor.
+	 */
+	~ReviewDialog();
+
+	/**
+	 * @brief Returns the number of replacements chosen so far.
+	 * @return The number of replacements.
+	 */
+	int replacementCount() const;
+
+public slots:
+	void done(int result);
+
+private slots:
+	void slotIgnore();
+	void slotIgnoreAll();
+	void slotAddWord();
+	void slotChange();
+	void slotChangeAll();
+	void slotSuggestionSelected(const QString& suggestion);
+	void slotSuggestionsReady(const QString& word);
+
+private:
+	ReviewDialogPrivate* d_ptr;
+	Q_DECLARE_PRIVATE(ReviewDialog)
+};
+
+} // QtSpell
+
+#endif // QTSPELL_REVIEWDIALOG_HPP
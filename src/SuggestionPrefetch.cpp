@@ -0,0 +1,141 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "SuggestionPrefetch.hpp"
+#include "Checker_p.hpp"
+
+#include <QRunnable>
+#include <QThreadPool>
+
+namespace QtSpell {
+
+class SuggestionPrefetch::SuggestTask : public QRunnable
+{
+public:
+	SuggestTask(SuggestionPrefetch* prefetch, const QStringList& words, int generation)
+		: m_prefetch(prefetch), m_words(words), m_generation(generation) {}
+	void run(){
+		m_prefetch->suggest(m_words, m_generation);
+	}
+
+private:
+	SuggestionPrefetch* m_prefetch;
+	QStringList m_words;
+	int m_generation;
+};
+
+SuggestionPrefetch::SuggestionPrefetch(Checker* checker, CheckerPrivate* d)
+	: m_checker(checker), m_d(d)
+{
+}
+
+SuggestionPrefetch::~SuggestionPrefetch()
+{
+	cancel();
+}
+
+void SuggestionPrefetch::prefetch(const QStringList& words)
+{
+	QStringList pending;
+	for(const QString& word : words){
+		if(m_d->suggestionCache.contains(word)){
+			emit m_checker->spellingSuggestionsReady(word);
+		}else if(!m_inFlight.contains(word)){
+			m_inFlight.insert(word);
+			pending.append(word);
+		}
+	}
+	if(pending.isEmpty()){
+		return;
+	}
+	// The workers only look up words, resolve the dictionary here
+	m_d->dict();
+	{
+		QMutexLocker locker(&m_mutex);
+		m_stop = NoStop;
+		++m_tasksRunning;
+	}
+	workerPool()->start(new SuggestTask(this, pending, m_d->cacheGeneration));
+}
+
+void SuggestionPrefetch::cancel()
+{
+	m_stop = Cancelled;
+	QMutexLocker locker(&m_mutex);
+	waitForTasks();
+	m_results.clear();
+	m_requeued.clear();
+	m_inFlight.clear();
+}
+
+void SuggestionPrefetch::suggest(const QStringList& words, int generation)
+{
+	QThread::currentThread()->setPriority(workerSettings().priority);
+	int done = 0;
+	for(const QString& word : words){
+		if(stopRequested()){
+			break;
+		}
+		Result result;
+		result.word = word;
+		result.suggestions = m_d->suggestWord(word);
+		result.generation = generation;
+		++done;
+		// Hand over each word on its own, the first one is usually awaited
+		QMutexLocker locker(&m_mutex);
+		if(m_stop.load() != Cancelled){
+			m_results.append(result);
+			QMetaObject::invokeMethod(this, "applySuggestions", Qt::QueuedConnection);
+		}
+	}
+	QMutexLocker locker(&m_mutex);
+	if(m_stop.load() == Interrupted && done < words.size()){
+		// Interrupted by fork(), the words left are queued again
+		m_requeued += words.mid(done);
+		QMetaObject::invokeMethod(this, "applySuggestions", Qt::QueuedConnection);
+	}
+	--m_tasksRunning;
+	m_idle.wakeAll();
+}
+
+void SuggestionPrefetch::applySuggestions()
+{
+	QList<Result> results;
+	QStringList requeued;
+	{
+		QMutexLocker locker(&m_mutex);
+		results.swap(m_results);
+		requeued.swap(m_requeued);
+	}
+	for(const Result& result : results){
+		m_inFlight.remove(result.word);
+		// Suggestions looked up before the caches were cleared may be outdated
+		if(result.generation == m_d->cacheGeneration){
+			m_d->cacheSuggestions(result.word, result.suggestions);
+		}
+		emit m_checker->spellingSuggestionsReady(result.word);
+	}
+	if(!requeued.isEmpty()){
+		for(const QString& word : requeued){
+			m_inFlight.remove(word);
+		}
+		prefetch(requeued);
+	}
+}
+
+} // QtSpell
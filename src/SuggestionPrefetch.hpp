@@ -0,0 +1,81 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef QTSPELL_SUGGESTIONPREFETCH_HPP
+#define QTSPELL_SUGGESTIONPREFETCH_HPP
+
+#include "Checker_p.hpp"
+
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+
+namespace QtSpell {
+
+class Checker;
+class CheckerPrivate;
+
+/**
+ * @brief Looks up spelling suggestions on the worker threads and moves them
+ *        into the suggestion cache from the event loop.
+ */
+class SuggestionPrefetch : public QObject, public WorkerClient
+{
+	Q_OBJECT
+public:
+	SuggestionPrefetch(Checker* checker, CheckerPrivate* d);
+	~SuggestionPrefetch();
+
+	/**
+	 * @brief Queue the lookup of the words, in order.
+	 */
+	void prefetch(const QStringList& words);
+
+	/**
+	 * @brief Stop looking up, waiting for running lookups to finish.
+	 */
+	void cancel();
+
+private slots:
+	void applySuggestions();
+
+private:
+	class SuggestTask;
+
+	struct Result {
+		QString word;
+		QList<QString> suggestions;
+		int generation;
+	};
+
+	Checker* m_checker;
+	CheckerPrivate* m_d;
+	QSet<QString> m_inFlight;
+
+	// Shared with the worker threads, besides the state of WorkerClient
+	QList<Result> m_results;
+	QStringList m_requeued;
+
+	void suggest(const QStringList& words, int generation);
+};
+
+} // QtSpell
+
+#endif // QTSPELL_SUGGESTIONPREFETCH_HPP
@@ -0,0 +1,184 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "SyntaxHighlighter.hpp"
+#include "TextEditChecker_p.hpp"
+#include "Tokenizer.hpp"
+
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QTextBlock>
+#include <QTextDocument>
+
+namespace QtSpell {
+
+class SyntaxHighlighterPrivate
+{
+public:
+	SyntaxHighlighter* q_ptr;
+	QPointer<Checker> checker;
+
+	void releaseChecker();
+	void underline(int start, int count);
+	bool noSpellingPropertySet(int propertyId, int pos) const;
+
+	Q_DECLARE_PUBLIC(SyntaxHighlighter)
+};
+
+void SyntaxHighlighterPrivate::releaseChecker()
+{
+	Q_Q(SyntaxHighlighter);
+	if(!checker){
+		return;
+	}
+	QObject::disconnect(checker, nullptr, q, nullptr);
+	if(TextEditChecker* textEditChecker = qobject_cast<TextEditChecker*>(checker)){
+		TextEditCheckerPrivate* checkerPrivate = TextEditCheckerPrivate::get(textEditChecker);
+		checkerPrivate->highlighter = nullptr;
+		if(DocumentState* state = checkerPrivate->documentState(q->document())){
+			// Underline through the document again
+			checkerPrivate->checkSpelling(state, 0, -1);
+		}
+	}
+	checker = nullptr;
+}
+
+void SyntaxHighlighterPrivate::underline(int start, int count)
+{
+	Q_Q(SyntaxHighlighter);
+	// Keep the formats of the application highlighting, only add the underline
+	for(int i = start, end = start + count; i < end;){
+		QTextCharFormat fmt = q->format(i);
+		int next = i + 1;
+		while(next < end && q->format(next) == fmt){
+			++next;
+		}
+		fmt.setFontUnderline(true);
+		fmt.setUnderlineColor(Qt::red);
+		fmt.setUnderlineStyle(QTextCharFormat::WaveUnderline);
+		q->setFormat(i, next - i, fmt);
+		i = next;
+	}
+}
+
+bool SyntaxHighlighterPrivate::noSpellingPropertySet(int propertyId, int pos) const
+{
+	Q_Q(const SyntaxHighlighter);
+	// As TextEditCheckerPrivate::noSpellingPropertySet, for the word ending at pos
+	if(propertyId < QTextFormat::UserProperty){
+		return false;
+	}
+	if(q->format(pos - 1).intProperty(propertyId) == 1){
+		return true;
+	}
+	QTextBlock block = q->currentBlock();
+	int docPos = block.position() + pos - 1;
+	for(QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it){
+		QTextFragment fragment = it.fragment();
+		if(fragment.contains(docPos)){
+			return fragment.charFormat().intProperty(propertyId) == 1;
+		}
+	}
+	return false;
+}
+
+SyntaxHighlighter::SyntaxHighlighter(QTextDocument* document)
+	: QSyntaxHighlighter(document)
+	, d_ptr(new SyntaxHighlighterPrivate)
+{
+	d_ptr->q_ptr = this;
+}
+
+SyntaxHighlighter::~SyntaxHighlighter()
+{
+	d_ptr->releaseChecker();
+	delete d_ptr;
+}
+
+void SyntaxHighlighter::setChecker(Checker* checker)
+{
+	Q_D(SyntaxHighlighter);
+	if(d->checker == checker){
+		return;
+	}
+	d->releaseChecker();
+	d->checker = checker;
+	if(checker){
+		connect(checker, &Checker::languageChanged, this, &SyntaxHighlighter::rehighlight);
+		connect(checker, &QObject::destroyed, this, &SyntaxHighlighter::rehighlight);
+		if(TextEditChecker* textEditChecker = qobject_cast<TextEditChecker*>(checker)){
+			TextEditCheckerPrivate* checkerPrivate = TextEditCheckerPrivate::get(textEditChecker);
+			checkerPrivate->highlighter = this;
+			DocumentState* state = checkerPrivate->documentState(document());
+			if(state && checkerPrivate->highlighterActive(state)){
+				// Drop the underlines the checker wrote into the document
+				checkerPrivate->clearSpellingFormat(state);
+				state->deferredBlocks.clear();
+			}
+		}
+	}
+	if(document()){
+		rehighlight();
+	}
+}
+
+Checker* SyntaxHighlighter::checker() const
+{
+	Q_D(const SyntaxHighlighter);
+	return d->checker;
+}
+
+void SyntaxHighlighter::highlightBlock(const QString& text)
+{
+	highlightSpelling(text);
+}
+
+void SyntaxHighlighter::highlightSpelling(const QString& text)
+{
+	Q_D(SyntaxHighlighter);
+	Checker* checker = d->checker;
+	if(!checker || !checker->getSpellingEnabled()){
+		return;
+	}
+	QElapsedTimer timer;
+	timer.start();
+	TextEditChecker* textEditChecker = qobject_cast<TextEditChecker*>(checker);
+	int noSpellingProperty = textEditChecker ? textEditChecker->noSpellingPropertyId() : -1;
+
+	Tokenizer<> tokenizer(text);
+	int start, end;
+	while(tokenizer.next(&start, &end)){
+		if(d->noSpellingPropertySet(noSpellingProperty, end)){
+			continue;
+		}
+		if(!checker->checkWord(tokenizer.word(start, end))){
+			d->underline(start, end - start);
+		}
+	}
+	if(textEditChecker){
+		// The checker leaves the edits to this pass, account for it in its stead
+		TextEditCheckerPrivate* checkerPrivate = TextEditCheckerPrivate::get(textEditChecker);
+		const DocumentState* state = checkerPrivate->documentState(document());
+		if(state && checkerPrivate->highlighterActive(state)){
+			checkerPrivate->recordKeystrokeLatency(document(), timer.nsecsElapsed() / 1000);
+		}
+	}
+}
+
+} // QtSpell
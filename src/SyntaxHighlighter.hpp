@@ -0,0 +1,92 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef QTSPELL_SYNTAXHIGHLIGHTER_HPP
+#define QTSPELL_SYNTAXHIGHLIGHTER_HPP
+
+#include "QtSpell.hpp"
+
+#include <QSyntaxHighlighter>
+
+namespace QtSpell {
+
+class SyntaxHighlighterPrivate;
+
+/**
+ * @brief A syntax highlighter which underlines misspelled words.
+ * @details Use this as base class of an application syntax highlighter to
+ *          check the spelling in the same pass as the highlighting: call
+ *          highlightSpelling at the end of the highlightBlock
+ *          reimplementation. The misspellings are then merged into the
+ *          highlighting formats instead of being written to the document.
+ *          If the checker is a TextEditChecker attached to a widget showing
+ *          the same document, the checker leaves all checking to the
+ *          highlighter, so that each edit costs a single block pass, while it
+ *          still provides the context menu and undo/redo.
+ */
+class QTSPELL_API SyntaxHighlighter : public QSyntaxHighlighter
+{
+	Q_OBJECT
+public:
+	/**
+	 * @brief SyntaxHighlighter object constructor.
+	 * @param document The document to highlight.
+	 */
+	SyntaxHighlighter(QTextDocument* document);
+
+	/**
+	 * @brief SyntaxHighlighter object destructor.
+	 */
+	~SyntaxHighlighter();
+
+	/**
+	 * @brief Set the checker which decides which words are misspelled.
+	 * @param checker The checker, or a null pointer to disable the spell
+	 *                checking pass.
+	 */
+	void setChecker(Checker* checker);
+
+	/**
+	 * @brief Returns the checker which decides which words are misspelled.
+	 * @return The checker, a null pointer if none is set.
+	 */
+	Checker* checker() const;
+
+protected:
+	/**
+	 * @brief Highlights the misspelled words of the block. Reimplementations
+	 *        should call highlightSpelling after applying their own formats.
+	 * @param text The text of the block.
+	 */
+	void highlightBlock(const QString& text);
+
+	/**
+	 * @brief Underlines the misspelled words of the current block, merging
+	 *        the underline into the formats set so far in this pass.
+	 * @param text The text of the block, as passed to highlightBlock.
+	 */
+	void highlightSpelling(const QString& text);
+
+private:
+	SyntaxHighlighterPrivate* d_ptr;
+	Q_DECLARE_PRIVATE(SyntaxHighlighter)
+};
+
+} // QtSpell
+
+#endif // QTSPELL_SYNTAXHIGHLIGHTER_HPP
@@ -17,16 +17,54 @@
  */
 
 #include "QtSpell.hpp"
+#include "BackgroundCheck.hpp"
 #include "TextEditChecker_p.hpp"
+#include "TextStatisticsIndex.hpp"
+#include "TraceRecorder.hpp"
 #include "UndoRedoStack.hpp"
 
+#include <QAbstractTextDocumentLayout>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QPlainTextEdit>
+#include <QRandomGenerator>
 #include <QTextEdit>
 #include <QTextBlock>
+#include <QTimer>
+#include <algorithm>
+#include <climits>
+#include <cmath>
 
 namespace QtSpell {
 
+// Full checks of larger documents run in the background if worker threads are enabled
+static const int BACKGROUND_CHECK_MIN_CHARS = 64 * 1024;
+
+// Finds the word of the block text which contains pos or ends or starts at it, by
+// the word boundaries of Tokenizer<> which all checking uses.
+static bool word_at(const QString& text, int pos, int* start, int* end)
+{
+	// Words consist of word characters and joiners only, a tokenizer can start after anything else
+	int from = pos;
+	while(from > 0){
+		QChar c = text[from - 1];
+		if(!c.isSurrogate() && !Tokenizer<>::isWordChar(c.unicode()) && !Tokenizer<>::isJoiner(c.unicode())){
+			break;
+		}
+		--from;
+	}
+	Tokenizer<> tokenizer(text, from);
+	while(tokenizer.next(start, end)){
+		if(*start > pos){
+			return false;
+		}
+		if(*end >= pos){
+			return true;
+		}
+	}
+	return false;
+}
+
 TextEditCheckerPrivate::TextEditCheckerPrivate()
 	: CheckerPrivate()
 {
@@ -38,64 +76,60 @@ TextEditCheckerPrivate::~TextEditCheckerPrivate()
 
 ///////////////////////////////////////////////////////////////////////////////
 
-QString TextCursor::nextChar(int num) const
+void TextCursor::moveWordStart(MoveMode moveMode)
 {
-	TextCursor testCursor(*this);
-	if(num > 1)
-		testCursor.movePosition(NextCharacter, MoveAnchor, num - 1);
-	else
-		testCursor.setPosition(testCursor.position());
-	testCursor.movePosition(NextCharacter, KeepAnchor);
-	return testCursor.selectedText();
+	QTextBlock block = this->block();
+	int start, end;
+	if(word_at(block.text(), positionInBlock(), &start, &end)){
+		setPosition(block.position() + start, moveMode);
+	}
+	qCDebug(qtspellTokenize) << "Start:" << position();
 }
 
-QString TextCursor::prevChar(int num) const
+void TextCursor::moveWordEnd(MoveMode moveMode)
 {
-	TextCursor testCursor(*this);
-	if(num > 1)
-		testCursor.movePosition(PreviousCharacter, MoveAnchor, num - 1);
-	else
-		testCursor.setPosition(testCursor.position());
-	testCursor.movePosition(PreviousCharacter, KeepAnchor);
-	return testCursor.selectedText();
+	QTextBlock block = this->block();
+	int start, end;
+	if(word_at(block.text(), positionInBlock(), &start, &end)){
+		setPosition(block.position() + end, moveMode);
+	}
+	qCDebug(qtspellTokenize) << "End:" << position();
 }
 
-void TextCursor::moveWordStart(MoveMode moveMode)
+///////////////////////////////////////////////////////////////////////////////
+
+QHash<const QTextDocument*, QList<TextEditChecker*>> DocumentCheckers::s_checkers;
+
+void DocumentCheckers::add(const QTextDocument* document, TextEditChecker* checker)
 {
-	movePosition(StartOfWord, moveMode);
-	qDebug() << "Start: " << position() << ": " << prevChar(2) << prevChar() << "|" << nextChar();
-	// If we are in front of a quote...
-	if(nextChar() == "'"){
-		// If the previous char is alphanumeric, move left one word, otherwise move right one char
-		if(prevChar().contains(m_wordRegEx)){
-			movePosition(WordLeft, moveMode);
-		}else{
-			movePosition(NextCharacter, moveMode);
+	s_checkers[document].append(checker);
+}
+
+void DocumentCheckers::remove(const QTextDocument* document, TextEditChecker* checker)
+{
+	QHash<const QTextDocument*, QList<TextEditChecker*>>::iterator it = s_checkers.find(document);
+	if(it != s_checkers.end()){
+		it.value().removeOne(checker);
+		if(it.value().isEmpty()){
+			s_checkers.erase(it);
 		}
 	}
-	// If the previous char is a quote, and the char before that is alphanumeric, move left one word
-	else if(prevChar() == "'" && prevChar(2).contains(m_wordRegEx)){
-		movePosition(WordLeft, moveMode, 2); // 2: because quote counts as a word boundary
-	}
 }
 
-void TextCursor::moveWordEnd(MoveMode moveMode)
+TextEditChecker* DocumentCheckers::owner(const QTextDocument* document)
 {
-	movePosition(EndOfWord, moveMode);
-	qDebug() << "End: " << position() << ": " << prevChar() << " | " << nextChar() << "|" << nextChar(2);
-	// If we are in behind of a quote...
-	if(prevChar() == "'"){
-		// If the next char is alphanumeric, move right one word, otherwise move left one char
-		if(nextChar().contains(m_wordRegEx)){
-			movePosition(WordRight, moveMode);
-		}else{
-			movePosition(PreviousCharacter, moveMode);
+	const QList<TextEditChecker*> checkers = s_checkers.value(document);
+	for(TextEditChecker* checker : checkers){
+		if(checker->attachMode() == TextEditChecker::ReadWriteMode){
+			return checker;
 		}
 	}
-	// If the next char is a quote, and the char after that is alphanumeric, move right one word
-	else if(nextChar() == "'" && nextChar(2).contains(m_wordRegEx)){
-		movePosition(WordRight, moveMode, 2); // 2: because quote counts as a word boundary
-	}
+	return checkers.isEmpty() ? nullptr : checkers.first();
+}
+
+QList<TextEditChecker*> DocumentCheckers::checkers(const QTextDocument* document)
+{
+	return s_checkers.value(document);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -108,7 +142,9 @@ TextEditChecker::TextEditChecker(QObject* parent)
 TextEditChecker::~TextEditChecker()
 {
 	Q_D(TextEditChecker);
-	d->setTextEdit(nullptr);
+	while(!d->textEdits.isEmpty()){
+		d->detachTextEdit(d->textEdits.last(), true);
+	}
 }
 
 void TextEditChecker::setTextEdit(QTextEdit* textEdit)
@@ -123,47 +159,476 @@ void TextEditChecker::setTextEdit(QPlainTextEdit* textEdit)
 	d->setTextEdit(textEdit ? new TextEditProxyT<QPlainTextEdit>(textEdit) : nullptr);
 }
 
-void TextEditCheckerPrivate::setTextEdit(TextEditProxy *newTextEdit)
+void TextEditChecker::addTextEdit(QTextEdit* textEdit)
 {
-	Q_Q(TextEditChecker);
+	Q_D(TextEditChecker);
 	if(textEdit){
-		QObject::disconnect(textEdit, &TextEditProxy::editDestroyed, q, &TextEditChecker::slotDetachTextEdit);
-		QObject::disconnect(textEdit, &TextEditProxy::textChanged, q, &TextEditChecker::slotCheckDocumentChanged);
-		QObject::disconnect(textEdit, &TextEditProxy::customContextMenuRequested, q, &TextEditChecker::slotShowContextMenu);
-		QObject::disconnect(textEdit->document(), &QTextDocument::contentsChange, q, &TextEditChecker::slotCheckRange);
-		textEdit->setContextMenuPolicy(oldContextMenuPolicy);
-		textEdit->removeEventFilter(q);
-
-		// Remove spelling format
-		QTextCursor cursor = textEdit->textCursor();
-		cursor.movePosition(QTextCursor::Start);
-		cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
-		QTextCharFormat fmt = cursor.charFormat();
-		QTextCharFormat defaultFormat = QTextCharFormat();
-		fmt.setFontUnderline(defaultFormat.fontUnderline());
-		fmt.setUnderlineColor(defaultFormat.underlineColor());
-		fmt.setUnderlineStyle(defaultFormat.underlineStyle());
-		cursor.setCharFormat(fmt);
-	}
-	bool undoWasEnabled = undoRedoStack != nullptr;
-	q->setUndoRedoEnabled(false);
-	delete textEdit;
-	document = nullptr;
-	textEdit = newTextEdit;
+		d->attachTextEdit(new TextEditProxyT<QTextEdit>(textEdit), d->textEdits.size());
+	}
+}
+
+void TextEditChecker::addTextEdit(QPlainTextEdit* textEdit)
+{
+	Q_D(TextEditChecker);
 	if(textEdit){
-		document = textEdit->document();
-		QObject::connect(textEdit, &TextEditProxy::editDestroyed, q, &TextEditChecker::slotDetachTextEdit);
-		QObject::connect(textEdit, &TextEditProxy::textChanged, q, &TextEditChecker::slotCheckDocumentChanged);
-		QObject::connect(textEdit, &TextEditProxy::customContextMenuRequested, q, &TextEditChecker::slotShowContextMenu);
-		QObject::connect(textEdit->document(), &QTextDocument::contentsChange, q, &TextEditChecker::slotCheckRange);
-		oldContextMenuPolicy = textEdit->contextMenuPolicy();
-		q->setUndoRedoEnabled(undoWasEnabled);
-		textEdit->setContextMenuPolicy(Qt::CustomContextMenu);
+		d->attachTextEdit(new TextEditProxyT<QPlainTextEdit>(textEdit), d->textEdits.size());
+	}
+}
+
+void TextEditChecker::removeTextEdit(QWidget* textEdit)
+{
+	Q_D(TextEditChecker);
+	if(TextEditProxy* proxy = d->findTextEdit(textEdit)){
+		d->detachTextEdit(proxy, true);
+	}
+}
+
+QList<QWidget*> TextEditChecker::textEdits() const
+{
+	Q_D(const TextEditChecker);
+	QList<QWidget*> textEdits;
+	for(TextEditProxy* textEdit : d->textEdits){
+		textEdits.append(textEdit->widget());
+	}
+	return textEdits;
+}
+
+void TextEditCheckerPrivate::setTextEdit(TextEditProxy* newTextEdit)
+{
+	// Replaces the first widget, the widgets added with addTextEdit stay attached
+	if(!textEdits.isEmpty()){
+		detachTextEdit(textEdits.first(), true);
+	}
+	if(newTextEdit){
+		attachTextEdit(newTextEdit, 0);
+	}
+}
+
+void TextEditCheckerPrivate::attachTextEdit(TextEditProxy* newTextEdit, int index)
+{
+	Q_Q(TextEditChecker);
+	if(TextEditProxy* attached = findTextEdit(newTextEdit->widget())){
+		// Only its place in the list changes
+		delete newTextEdit;
+		textEdits.removeOne(attached);
+		textEdits.insert(qMin(index, textEdits.size()), attached);
+		return;
+	}
+	textEdits.insert(index, newTextEdit);
+	QObject::connect(newTextEdit, &TextEditProxy::editDestroyed, q, &TextEditChecker::slotDetachTextEdit);
+	QObject::connect(newTextEdit, &TextEditProxy::textChanged, q, &TextEditChecker::slotCheckDocumentChanged);
+	installEditHooks(newTextEdit);
+	attachDocument(newTextEdit);
+}
+
+void TextEditCheckerPrivate::detachTextEdit(TextEditProxy* oldTextEdit, bool widgetAlive)
+{
+	Q_Q(TextEditChecker);
+	QObject::disconnect(oldTextEdit, nullptr, q, nullptr);
+	if(widgetAlive){
+		removeEditHooks(oldTextEdit);
+	}
+	textEdits.removeOne(oldTextEdit);
+	detachDocument(oldTextEdit, widgetAlive);
+	delete oldTextEdit;
+}
+
+TextEditProxy* TextEditCheckerPrivate::findTextEdit(const QObject* widget) const
+{
+	for(TextEditProxy* textEdit : textEdits){
+		if(textEdit->widget() == widget){
+			return textEdit;
+		}
+	}
+	return nullptr;
+}
+
+TextEditProxy* TextEditCheckerPrivate::currentTextEdit() const
+{
+	// The widget the user works in, if any
+	for(TextEditProxy* textEdit : textEdits){
+		if(textEdit->widget()->hasFocus()){
+			return textEdit;
+		}
+	}
+	return textEdits.value(0);
+}
+
+void TextEditCheckerPrivate::attachDocument(TextEditProxy* textEdit)
+{
+	Q_Q(TextEditChecker);
+	QTextDocument* document = textEdit->document();
+	textEdit->checkedDocument = document;
+	if(documentState(document)){
+		// Already checked for another widget showing it
+		return;
+	}
+	DocumentState* state = new DocumentState;
+	state->document = document;
+	state->textEdit = textEdit;
+	documents.append(state);
+	DocumentCheckers::add(document, q);
+	state->layoutConnection = QObject::connect(document->documentLayout(), &QAbstractTextDocumentLayout::update, q, &TextEditChecker::slotCheckRevealedBlocks);
+	installEditHooks(state);
+	if(undoRedoEnabled){
+		createUndoRedoStack(state);
+	}
+	if(textStatisticsEnabled){
+		state->textStatistics = new TextStatisticsIndex;
+		resetTextStatistics(state);
+	}
+	if(!isDocumentOwner(document)){
+		// The document is already checked on behalf of another checker
+	}else if(attachMode == TextEditChecker::ReadOnlyMode){
+		scheduleCheck(state);
+	}else if(attachMode == TextEditChecker::AppendOnlyMode){
+		scheduleAppendCheck(state, 0);
+	}else{
+		checkSpelling(state, 0, -1);
+	}
+}
+
+void TextEditCheckerPrivate::detachDocument(TextEditProxy* textEdit, bool widgetAlive)
+{
+	Q_Q(TextEditChecker);
+	DocumentState* state = documentState(textEdit->checkedDocument);
+	textEdit->checkedDocument = nullptr;
+	if(!state){
+		return;
+	}
+	for(TextEditProxy* other : qAsConst(textEdits)){
+		if(other->checkedDocument == state->document){
+			// Still shown by another widget, undo/redo goes through that one from now on
+			if(state->textEdit == textEdit){
+				state->textEdit = other;
+				if(state->undoRedoStack){
+					state->undoRedoStack->setTextEdit(other);
+				}
+			}
+			return;
+		}
+	}
+	if(state->backgroundCheck){
+		state->backgroundCheck->cancel();
+	}
+	QTextDocument* document = state->document;
+	bool wasOwner = DocumentCheckers::owner(document) == q;
+	DocumentCheckers::remove(document, q);
+	// The next owner resets the underlines once the last view is detached...
+	if(TextEditChecker* owner = DocumentCheckers::owner(document)){
+		TextEditCheckerPrivate* ownerd = owner->d_func();
+		DocumentState* ownerState = ownerd->documentState(document);
+		if(!state->underlinedRange.isNull()){
+			ownerd->trackUnderline(ownerState, state->underlinedRange.selectionStart(), state->underlinedRange.selectionEnd());
+		}
+		// ...and goes on with the undo history of the document
+		if(wasOwner && state->undoRedoStack && ownerState->undoRedoStack){
+			ownerd->takeUndoRedoStack(ownerState, state);
+		}
+	}else if(widgetAlive){
+		clearSpellingFormat(state);
+	}
+	// The layout of a deleted document is gone already, so don't disconnect by sender
+	QObject::disconnect(state->layoutConnection);
+	removeEditHooks(state);
+	if(menuDocument == state){
+		menuDocument = nullptr;
+	}
+	documents.removeOne(state);
+	delete state->undoRedoStack;
+	delete state->backgroundCheck;
+	bool hadStatistics = state->textStatistics != nullptr;
+	delete state->textStatistics;
+	delete state;
+	if(undoRedoEnabled){
+		emit q->undoAvailable(false);
+		emit q->redoAvailable(false);
+	}
+	if(hadStatistics){
+		emit q->textStatisticsChanged();
+	}
+}
+
+DocumentState* TextEditCheckerPrivate::documentState(const QTextDocument* document) const
+{
+	for(DocumentState* state : documents){
+		if(state->document == document){
+			return state;
+		}
+	}
+	return nullptr;
+}
+
+DocumentState* TextEditCheckerPrivate::textEditDocument(const QWidget* widget) const
+{
+	TextEditProxy* textEdit = findTextEdit(widget);
+	return textEdit ? documentState(textEdit->checkedDocument) : nullptr;
+}
+
+DocumentState* TextEditCheckerPrivate::currentDocument() const
+{
+	if(menuDocument){
+		return menuDocument;
+	}
+	return textEdits.isEmpty() ? nullptr : documentState(textEdits.first()->checkedDocument);
+}
+
+bool TextEditCheckerPrivate::isDocumentOwner(const QTextDocument* document) const
+{
+	Q_Q(const TextEditChecker);
+	TextEditChecker* owner = DocumentCheckers::owner(document);
+	return !owner || owner == q;
+}
+
+bool TextEditCheckerPrivate::tracing(const DocumentState* state) const
+{
+	// Traces follow the first widget, see TextEditChecker::startTraceRecording
+	return traceRecorder && !textEdits.isEmpty() && textEdits.first()->checkedDocument == state->document;
+}
+
+void TextEditCheckerPrivate::trackUnderline(DocumentState* state, int start, int end)
+{
+	QTextCursor& range = state->underlinedRange;
+	if(!range.isNull()){
+		start = qMin(start, range.selectionStart());
+		end = qMax(end, range.selectionEnd());
+	}else{
+		range = QTextCursor(state->document);
+	}
+	range.setPosition(start);
+	range.setPosition(end, QTextCursor::KeepAnchor);
+}
+
+void TextEditCheckerPrivate::clearSpellingFormat(DocumentState* state)
+{
+	// Only the range underlined by the owner of the document needs to be reset
+	TextEditChecker* owner = DocumentCheckers::owner(state->document);
+	QTextCursor& range = owner ? owner->d_func()->documentState(state->document)->underlinedRange : state->underlinedRange;
+	if(range.isNull()){
+		return;
+	}
+	QTextCursor cursor = range;
+	range = QTextCursor();
+	QTextCharFormat fmt = cursor.charFormat();
+	QTextCharFormat defaultFormat = QTextCharFormat();
+	fmt.setFontUnderline(defaultFormat.fontUnderline());
+	fmt.setUnderlineColor(defaultFormat.underlineColor());
+	fmt.setUnderlineStyle(defaultFormat.underlineStyle());
+	// Not an edit: checkers still attached must neither record nor recheck it
+	QTextDocument* doc = cursor.document();
+	bool signalsWereBlocked = doc->blockSignals(true);
+	cursor.setCharFormat(fmt);
+	doc->blockSignals(signalsWereBlocked);
+}
+
+void TextEditCheckerPrivate::undoRedo(TextEditProxy* textEdit, bool redo)
+{
+	DocumentState* state = documentState(textEdit->checkedDocument);
+	if(!state){
+		return;
+	}
+	if(tracing(state)){
+		traceRecorder->recordAction(redo ? "redo" : "undo");
+	}
+	// The owner of the document keeps the history
+	TextEditChecker* owner = DocumentCheckers::owner(state->document);
+	TextEditCheckerPrivate* ownerd = owner ? owner->d_func() : this;
+	DocumentState* ownerState = ownerd->documentState(state->document);
+	if(!ownerState->undoRedoStack){
+		return;
+	}
+	// The stack moves the cursor of the widget it belongs to, the one of this widget should follow the change
+	TextEditProxy* stackTextEdit = ownerState->textEdit;
+	QTextCursor stackCursor = stackTextEdit->textCursor();
+	state->undoRedoInProgress = true;
+	ownerState->undoRedoInProgress = true;
+	++ownerd->statistics.undoRedoSteps;
+	if(redo){
+		ownerState->undoRedoStack->redo();
+	}else{
+		ownerState->undoRedoStack->undo();
+	}
+	state->undoRedoInProgress = false;
+	ownerState->undoRedoInProgress = false;
+	if(stackTextEdit != textEdit){
+		textEdit->setTextCursor(stackTextEdit->textCursor());
+		stackTextEdit->setTextCursor(stackCursor);
+	}
+	textEdit->ensureCursorVisible();
+}
+
+void TextEditCheckerPrivate::createUndoRedoStack(DocumentState* state)
+{
+	Q_Q(TextEditChecker);
+	state->undoRedoStack = new UndoRedoStack(state->textEdit);
+	QObject::connect(state->undoRedoStack, &UndoRedoStack::undoAvailable, q, &TextEditChecker::undoAvailable);
+	QObject::connect(state->undoRedoStack, &UndoRedoStack::redoAvailable, q, &TextEditChecker::redoAvailable);
+}
+
+void TextEditCheckerPrivate::takeUndoRedoStack(DocumentState* state, DocumentState* previous)
+{
+	Q_Q(TextEditChecker);
+	// Non-owners never record anything, so the stack of this checker is empty
+	delete state->undoRedoStack;
+	state->undoRedoStack = previous->undoRedoStack;
+	previous->undoRedoStack = nullptr;
+	QObject::disconnect(state->undoRedoStack, nullptr, nullptr, nullptr);
+	QObject::connect(state->undoRedoStack, &UndoRedoStack::undoAvailable, q, &TextEditChecker::undoAvailable);
+	QObject::connect(state->undoRedoStack, &UndoRedoStack::redoAvailable, q, &TextEditChecker::redoAvailable);
+	state->undoRedoStack->setTextEdit(state->textEdit);
+	emit q->undoAvailable(state->undoRedoStack->canUndo());
+	emit q->redoAvailable(state->undoRedoStack->canRedo());
+}
+
+void TextEditCheckerPrivate::dictionaryChanged() const
+{
+	Q_Q(const TextEditChecker);
+	clearCaches();
+	// The owners check on behalf of this checker, so their verdicts are stale as well
+	for(const DocumentState* state : documents){
+		TextEditChecker* owner = DocumentCheckers::owner(state->document);
+		if(owner && owner != q){
+			owner->d_func()->clearCaches();
+		}
+	}
+}
+
+bool TextEditCheckerPrivate::highlighterActive(const DocumentState* state) const
+{
+	return highlighter && highlighter->document() == state->document;
+}
+
+void TextEditCheckerPrivate::recordKeystrokeLatency(const QTextDocument* document, qint64 usecs)
+{
+	// The edits are handled once for all checkers of the document, each of them accounts for them
+	const QList<TextEditChecker*> checkers = DocumentCheckers::checkers(document);
+	for(TextEditChecker* checker : checkers){
+		checker->d_func()->keystrokeLatency.record(usecs);
+	}
+}
+
+void TextEditCheckerPrivate::installEditHooks(TextEditProxy* textEdit)
+{
+	Q_Q(TextEditChecker);
+	if(attachMode == TextEditChecker::ReadOnlyMode){
+		return;
+	}
+	QObject::connect(textEdit, &TextEditProxy::customContextMenuRequested, q, &TextEditChecker::slotShowContextMenu);
+	textEdit->oldContextMenuPolicy = textEdit->contextMenuPolicy();
+	textEdit->setContextMenuPolicy(Qt::CustomContextMenu);
+	if(attachMode == TextEditChecker::ReadWriteMode){
 		textEdit->installEventFilter(q);
-		q->checkSpelling();
 	}
 }
 
+void TextEditCheckerPrivate::installEditHooks(DocumentState* state)
+{
+	Q_Q(TextEditChecker);
+	if(attachMode != TextEditChecker::ReadOnlyMode){
+		state->contentsConnection = QObject::connect(state->document, &QTextDocument::contentsChange, q, &TextEditChecker::slotCheckRange);
+	}
+}
+
+void TextEditCheckerPrivate::removeEditHooks(TextEditProxy* textEdit)
+{
+	Q_Q(TextEditChecker);
+	if(attachMode == TextEditChecker::ReadOnlyMode){
+		return;
+	}
+	QObject::disconnect(textEdit, &TextEditProxy::customContextMenuRequested, q, &TextEditChecker::slotShowContextMenu);
+	textEdit->setContextMenuPolicy(textEdit->oldContextMenuPolicy);
+	textEdit->removeEventFilter(q);
+}
+
+void TextEditCheckerPrivate::removeEditHooks(DocumentState* state)
+{
+	// As the layout connection, the document may be deleted already
+	QObject::disconnect(state->contentsConnection);
+	state->appendPending = QTextCursor();
+}
+
+void TextEditCheckerPrivate::scheduleCheck(DocumentState* state)
+{
+	Q_Q(TextEditChecker);
+	if(!state->checkScheduled){
+		state->checkScheduled = true;
+		// One call checks all documents scheduled by then
+		QTimer::singleShot(0, q, &TextEditChecker::slotScheduledCheck);
+	}
+}
+
+void TextEditCheckerPrivate::scheduleAppendCheck(DocumentState* state, int start, int end)
+{
+	// Only the blocks touched since the last check need to be checked, the rest was checked already
+	QTextDocument* doc = state->document;
+	if(end == -1){
+		end = doc->characterCount() - 1;
+	}
+	QTextBlock last = doc->findBlock(end);
+	start = doc->findBlock(start).position();
+	end = last.isValid() ? last.position() + last.length() - 1 : doc->characterCount() - 1;
+	QTextCursor& pending = state->appendPending;
+	if(!pending.isNull()){
+		start = qMin(start, pending.selectionStart());
+		end = qMax(end, pending.selectionEnd());
+	}else{
+		pending = QTextCursor(doc);
+		state->appendPendingUsecs = 0;
+	}
+	pending.setPosition(start);
+	pending.setPosition(end, QTextCursor::KeepAnchor);
+	scheduleCheck(state);
+}
+
+void TextEditCheckerPrivate::forgetRemovedBlocks(DocumentState* state, int pos)
+{
+	// The runs of removed blocks collapse onto the removal position. Blocks dropped through
+	// maximumBlockCount are removed from the front, where the oldest runs are.
+	QList<QTextCursor>& runs = state->deferredBlocks;
+	QList<QTextCursor>::iterator first = std::lower_bound(runs.begin(), runs.end(), pos, [](const QTextCursor& run, int p){ return run.selectionEnd() < p; });
+	QList<QTextCursor>::iterator last = first;
+	while(last != runs.end() && !last->hasSelection()){
+		++last;
+	}
+	runs.erase(first, last);
+}
+
+void TextEditChecker::setAttachMode(AttachMode mode)
+{
+	Q_D(TextEditChecker);
+	if(mode == d->attachMode){
+		return;
+	}
+	for(TextEditProxy* textEdit : qAsConst(d->textEdits)){
+		d->removeEditHooks(textEdit);
+	}
+	for(DocumentState* state : qAsConst(d->documents)){
+		d->removeEditHooks(state);
+		d->clearMisspellingIndex(state);
+	}
+	if(mode != ReadWriteMode){
+		setUndoRedoEnabled(false);
+	}
+	d->attachMode = mode;
+	for(TextEditProxy* textEdit : qAsConst(d->textEdits)){
+		d->installEditHooks(textEdit);
+	}
+	for(DocumentState* state : qAsConst(d->documents)){
+		d->installEditHooks(state);
+		if(mode == AppendOnlyMode){
+			d->scheduleAppendCheck(state, 0);
+		}else{
+			d->scheduleCheck(state);
+		}
+	}
+}
+
+TextEditChecker::AttachMode TextEditChecker::attachMode() const
+{
+	Q_D(const TextEditChecker);
+	return d->attachMode;
+}
+
 void TextEditChecker::setNoSpellingPropertyId(int propertyId)
 {
 	Q_D(TextEditChecker);
@@ -176,15 +641,319 @@ int TextEditChecker::noSpellingPropertyId() const
 	return d->noSpellingProperty;
 }
 
+void TextEditChecker::setDeferInvisibleBlocks(bool defer)
+{
+	Q_D(TextEditChecker);
+	d->deferInvisibleBlocks = defer;
+	if(!defer){
+		// Catch up on everything which was skipped so far
+		for(DocumentState* state : qAsConst(d->documents)){
+			d->checkRevealedBlocks(state, 0, INT_MAX);
+		}
+	}
+}
+
+bool TextEditChecker::deferInvisibleBlocks() const
+{
+	Q_D(const TextEditChecker);
+	return d->deferInvisibleBlocks;
+}
+
+void TextEditChecker::setTextStatisticsEnabled(bool enabled)
+{
+	Q_D(TextEditChecker);
+	if(enabled == d->textStatisticsEnabled){
+		return;
+	}
+	d->textStatisticsEnabled = enabled;
+	for(DocumentState* state : qAsConst(d->documents)){
+		if(enabled){
+			state->textStatistics = new TextStatisticsIndex;
+			d->resetTextStatistics(state);
+		}else{
+			delete state->textStatistics;
+			state->textStatistics = nullptr;
+		}
+	}
+}
+
+bool TextEditChecker::textStatisticsEnabled() const
+{
+	Q_D(const TextEditChecker);
+	return d->textStatisticsEnabled;
+}
+
+TextStatistics TextEditChecker::textStatistics() const
+{
+	Q_D(const TextEditChecker);
+	QList<const TextStatisticsIndex*> indexes;
+	for(const DocumentState* state : d->documents){
+		if(state->textStatistics){
+			indexes.append(state->textStatistics);
+		}
+	}
+	return TextStatisticsIndex::combined(indexes);
+}
+
+TextStatistics TextEditChecker::textStatistics(QWidget* textEdit) const
+{
+	Q_D(const TextEditChecker);
+	const DocumentState* state = d->textEditDocument(textEdit);
+	return state && state->textStatistics ? state->textStatistics->totals() : TextStatistics();
+}
+
+QList<Misspelling> TextEditChecker::misspellings(int start, int end) const
+{
+	Q_D(const TextEditChecker);
+	return d->misspellings(d->currentDocument(), start, end);
+}
+
+QList<Misspelling> TextEditChecker::misspellings(QWidget* textEdit, int start, int end) const
+{
+	Q_D(const TextEditChecker);
+	return d->misspellings(d->textEditDocument(textEdit), start, end);
+}
+
+QList<Misspelling> TextEditCheckerPrivate::misspellings(const DocumentState* state, int start, int end) const
+{
+	Q_Q(const TextEditChecker);
+	QList<Misspelling> result;
+	if(!state){
+		return result;
+	}
+	QTextDocument* document = state->document;
+	if(end == -1){
+		end = document->characterCount() - 1;
+	}
+	if(state->misspellingIndexed && !highlighterActive(state) && !state->checkScheduled && !(state->backgroundCheck && state->backgroundCheck->isRunning()) && state->deferredBlocks.isEmpty()){
+		// Served from the index, only dropping words added to the dictionary since they were checked
+		const QList<Misspelling>& index = state->misspellingIndex;
+		QList<Misspelling>::const_iterator it = std::lower_bound(index.begin(), index.end(), start, [](const Misspelling& misspelling, int pos){ return misspelling.start < pos; });
+		for(; it != index.end() && it->end <= end; ++it){
+			if(!q->checkWord(it->word)){
+				result.append(*it);
+			}
+		}
+		return result;
+	}
+	OperationWatch watch(this, "misspellings", end - start);
+	for(QTextBlock block = document->findBlock(start); block.isValid() && block.position() < end; block = block.next()){
+		blockMisspellings(block, start, end, result, &watch);
+	}
+	return result;
+}
+
+QualityEstimate TextEditChecker::estimateQuality(int budgetMsecs, int topWords) const
+{
+	Q_D(const TextEditChecker);
+	return d->estimateQuality(d->currentDocument(), budgetMsecs, topWords);
+}
+
+QualityEstimate TextEditChecker::estimateQuality(QWidget* textEdit, int budgetMsecs, int topWords) const
+{
+	Q_D(const TextEditChecker);
+	return d->estimateQuality(d->textEditDocument(textEdit), budgetMsecs, topWords);
+}
+
+QualityEstimate TextEditCheckerPrivate::estimateQuality(const DocumentState* state, int budgetMsecs, int topWords) const
+{
+	QualityEstimate estimate;
+	if(!state){
+		return estimate;
+	}
+	QTextDocument* document = state->document;
+	int blockCount = document->blockCount();
+	estimate.totalBlocks = blockCount;
+	OperationWatch watch(this, "estimateQuality", document->characterCount() - 1);
+	QElapsedTimer timer;
+	timer.start();
+
+	// Partial Fisher-Yates shuffle of the block numbers, only the swapped entries are stored
+	QHash<int, int> swapped;
+	QRandomGenerator* random = QRandomGenerator::global();
+	QVector<QPair<int, int>> samples;
+	QHash<QString, int> unknownWords;
+	QList<Misspelling> misspellings;
+	for(int i = 0; i < blockCount && (i == 0 || timer.elapsed() < budgetMsecs); ++i){
+		int j = i + int(random->bounded(blockCount - i));
+		int number = swapped.value(j, j);
+		swapped.insert(j, swapped.value(i, i));
+		QTextBlock block = document->findBlockByNumber(number);
+		misspellings.clear();
+		int words = blockMisspellings(block, block.position(), block.position() + block.length(), misspellings, &watch);
+		samples.append(qMakePair(words, misspellings.size()));
+		estimate.sampledWords += words;
+		estimate.sampledMisspellings += misspellings.size();
+		for(const Misspelling& misspelling : misspellings){
+			++unknownWords[misspelling.word];
+		}
+	}
+
+	int n = samples.size();
+	estimate.sampledBlocks = n;
+	estimate.complete = n == blockCount;
+	if(estimate.sampledWords > 0){
+		double rate = double(estimate.sampledMisspellings) / estimate.sampledWords;
+		estimate.misspellingRate = rate;
+		if(estimate.complete){
+			estimate.lowerBound = estimate.upperBound = rate;
+		}else if(n >= 2){
+			// Ratio estimator of a cluster sample, with finite population correction
+			double meanWords = double(estimate.sampledWords) / n;
+			double residuals = 0;
+			for(const QPair<int, int>& sample : samples){
+				double residual = sample.second - rate * sample.first;
+				residuals += residual * residual;
+			}
+			double variance = (1. - double(n) / blockCount) * residuals / (n - 1) / (n * meanWords * meanWords);
+			double margin = 1.96 * std::sqrt(variance);
+			estimate.lowerBound = qMax(0., rate - margin);
+			estimate.upperBound = qMin(1., rate + margin);
+			if(estimate.sampledMisspellings == 0){
+				// The variance vanishes without misspellings, use the rule of three instead
+				estimate.upperBound = qMin(1., 3. / estimate.sampledWords);
+			}
+		}
+	}
+
+	for(QHash<QString, int>::const_iterator it = unknownWords.constBegin(), itEnd = unknownWords.constEnd(); it != itEnd; ++it){
+		estimate.topUnknownWords.append(qMakePair(it.key(), it.value()));
+	}
+	std::sort(estimate.topUnknownWords.begin(), estimate.topUnknownWords.end(), [](const QPair<QString, int>& a, const QPair<QString, int>& b){
+		return a.second != b.second ? a.second > b.second : a.first < b.first;
+	});
+	if(estimate.topUnknownWords.size() > topWords){
+		estimate.topUnknownWords.erase(estimate.topUnknownWords.begin() + qMax(0, topWords), estimate.topUnknownWords.end());
+	}
+	return estimate;
+}
+
+int TextEditCheckerPrivate::blockMisspellings(const QTextBlock& block, int start, int end, QList<Misspelling>& result, OperationWatch* watch) const
+{
+	Q_Q(const TextEditChecker);
+	int blockPos = block.position();
+	QString text = block.text();
+	Tokenizer<> tokenizer(text);
+	// Only needed to look up the no-spelling property
+	QTextCursor cursor;
+	int words = 0;
+	int wordStart, wordEnd;
+	while(tokenizer.next(&wordStart, &wordEnd)){
+		if(blockPos + wordStart < start){
+			continue;
+		}
+		if(blockPos + wordEnd > end){
+			break;
+		}
+		Misspelling misspelling;
+		misspelling.start = blockPos + wordStart;
+		misspelling.end = blockPos + wordEnd;
+		misspelling.word = tokenizer.word(wordStart, wordEnd);
+		if(noSpellingProperty >= QTextFormat::UserProperty){
+			if(cursor.isNull()){
+				cursor = QTextCursor(block);
+			}
+			cursor.setPosition(misspelling.start);
+			cursor.setPosition(misspelling.end, QTextCursor::KeepAnchor);
+			if(noSpellingPropertySet(cursor)){
+				continue;
+			}
+		}
+		++words;
+		if(watch){
+			watch->startWord();
+		}
+		bool correct = q->checkWord(misspelling.word);
+		if(watch){
+			watch->finishWord(misspelling.word);
+		}
+		if(!correct){
+			result.append(misspelling);
+		}
+	}
+	return words;
+}
+
+void TextEditChecker::replaceWords(const QList<QPair<Misspelling, QString>>& replacements)
+{
+	Q_D(TextEditChecker);
+	d->replaceWords(d->currentDocument(), replacements);
+}
+
+void TextEditChecker::replaceWords(QWidget* textEdit, const QList<QPair<Misspelling, QString>>& replacements)
+{
+	Q_D(TextEditChecker);
+	d->replaceWords(d->textEditDocument(textEdit), replacements);
+}
+
+void TextEditCheckerPrivate::replaceWords(DocumentState* state, const QList<QPair<Misspelling, QString>>& replacements)
+{
+	Q_Q(TextEditChecker);
+	if(!state || replacements.isEmpty()){
+		return;
+	}
+	TextEditChecker* owner = DocumentCheckers::owner(state->document);
+	if(owner && owner != q){
+		// The owner of the document keeps the undo history
+		TextEditCheckerPrivate* ownerd = owner->d_func();
+		ownerd->replaceWords(ownerd->documentState(state->document), replacements);
+		return;
+	}
+	// Replace back to front, so that the positions of the remaining words stay valid
+	QList<QPair<Misspelling, QString>> sorted = replacements;
+	std::sort(sorted.begin(), sorted.end(), [](const QPair<Misspelling, QString>& a, const QPair<Misspelling, QString>& b){
+		return a.first.start > b.first.start;
+	});
+
+	// The undo stack records each replacement on its own and combines them into
+	// one step, the document's own undo needs them in a single edit block
+	QTextDocument* document = state->document;
+	QTextCursor cursor(document);
+	if(state->undoRedoStack){
+		state->undoRedoStack->beginGroup();
+	}else{
+		cursor.beginEditBlock();
+	}
+	int end = document->characterCount() - 1;
+	for(const QPair<Misspelling, QString>& replacement : sorted){
+		const Misspelling& misspelling = replacement.first;
+		if(misspelling.start < 0 || misspelling.end > end || misspelling.start >= misspelling.end){
+			continue;
+		}
+		cursor.setPosition(misspelling.start);
+		cursor.setPosition(misspelling.end, QTextCursor::KeepAnchor);
+		if(cursor.selectedText() != misspelling.word){
+			qCDebug(qtspellCheck) << "Not replacing changed word:" << misspelling.word << "(" << misspelling.start << "-" << misspelling.end << ")";
+			continue;
+		}
+		if(tracing(state)){
+			traceRecorder->setEditCause("replace");
+		}
+		cursor.insertText(replacement.second);
+		end = document->characterCount() - 1;
+	}
+	if(state->undoRedoStack){
+		state->undoRedoStack->endGroup();
+	}else{
+		cursor.endEditBlock();
+	}
+}
+
 bool TextEditChecker::eventFilter(QObject* obj, QEvent* event)
 {
-	if(event->type() == QEvent::KeyPress){
+	Q_D(TextEditChecker);
+	TextEditProxy* textEdit = event->type() == QEvent::KeyPress ? d->findTextEdit(obj) : nullptr;
+	if(textEdit){
 		QKeyEvent *keyEvent = static_cast<QKeyEvent *>(event);
+		DocumentState* state = d->documentState(textEdit->checkedDocument);
+		if(state && d->tracing(state)){
+			d->traceRecorder->recordKey(keyEvent);
+		}
 		if(keyEvent->key() == Qt::Key_Z && keyEvent->modifiers() == Qt::CTRL){
-			undo();
+			d->undoRedo(textEdit, false);
 			return true;
 		}else if(keyEvent->key() == Qt::Key_Z && keyEvent->modifiers() == (Qt::CTRL | Qt::SHIFT)){
-			redo();
+			d->undoRedo(textEdit, true);
 			return true;
 		}
 	}
@@ -194,16 +963,93 @@ bool TextEditChecker::eventFilter(QObject* obj, QEvent* event)
 void TextEditChecker::checkSpelling(int start, int end)
 {
 	Q_D(TextEditChecker);
+	if(start == 0 && end == -1){
+		// A full check covers the documents of all widgets
+		for(int i = 0; i < d->documents.size(); ++i){
+			d->checkSpelling(d->documents[i], 0, -1);
+		}
+	}else if(DocumentState* state = d->currentDocument()){
+		d->checkSpelling(state, start, end);
+	}
+}
+
+void TextEditCheckerPrivate::checkSpelling(DocumentState* state, int start, int end)
+{
+	Q_Q(TextEditChecker);
+	bool fullCheck = start == 0 && end == -1;
+	if(fullCheck){
+		// Full check, blocks which are still invisible are deferred again below
+		state->deferredBlocks.clear();
+	}
+	QTextDocument* document = state->document;
+	TextEditChecker* owner = DocumentCheckers::owner(document);
+	if(owner && owner != q){
+		// The owner of the document checks on behalf of all its views
+		TextEditCheckerPrivate* ownerd = owner->d_func();
+		ownerd->checkSpelling(ownerd->documentState(document), start, end);
+		return;
+	}
 	if(end == -1){
-		QTextCursor tmpCursor(d->textEdit->textCursor());
-		tmpCursor.movePosition(QTextCursor::End);
-		end = tmpCursor.position();
+		end = document->characterCount() - 1;
 	}
 
+	if(highlighterActive(state)){
+		// The highlighter checks the blocks as part of its own pass
+		if(start == 0 && end >= document->characterCount() - 1){
+			highlighter->rehighlight();
+		}else{
+			QTextBlock last = document->findBlock(end);
+			for(QTextBlock block = document->findBlock(start); block.isValid(); block = block.next()){
+				highlighter->rehighlightBlock(block);
+				if(block == last){
+					break;
+				}
+			}
+		}
+		statistics.charactersChecked += end - start;
+		++statistics.checkCount;
+		return;
+	}
+
+	if(fullCheck){
+		clearMisspellingIndex(state);
+		state->misspellingIndexed = attachMode == TextEditChecker::ReadOnlyMode;
+	}
+	if(fullCheck && state->backgroundCheck){
+		// Superseded by this check
+		state->backgroundCheck->cancel();
+	}
+	if(fullCheck && end > BACKGROUND_CHECK_MIN_CHARS && Checker::maxWorkerThreads() > 0){
+		if(!state->backgroundCheck){
+			state->backgroundCheck = new BackgroundCheck(this, state);
+		}
+		// The workers only look up words, resolve the dictionary here
+		dict();
+		state->backgroundCheck->start(document);
+		return;
+	}
+
+	OperationWatch watch(this, "checkSpelling", end - start);
+	QElapsedTimer timer;
+	timer.start();
+
 	// stop contentsChange signals from being emitted due to changed charFormats
-	d->textEdit->document()->blockSignals(true);
+	document->blockSignals(true);
+	// The lightweight modes keep the underlining out of the undo history of the document. Disabling
+	// undo discards the history, so that is only done while there is none. Documents which keep
+	// a history in these modes get the underlines as undo steps of their own, see setAttachMode.
+	bool lightweight = attachMode != TextEditChecker::ReadWriteMode;
+	bool suspendUndo = lightweight && document->isUndoRedoEnabled() && document->availableUndoSteps() == 0 && document->availableRedoSteps() == 0;
+	if(suspendUndo){
+		document->setUndoRedoEnabled(false);
+	}else if(lightweight && document->isUndoRedoEnabled() && !state->documentUndoWarned){
+		qCWarning(qtspellUndo) << "Undo/redo of the checked document is enabled in a lightweight attach mode,"
+							   << "the underlines are recorded in its history. Disable it with QTextDocument::setUndoRedoEnabled(false).";
+		state->documentUndoWarned = true;
+	}
+	QList<Misspelling> found;
 
-	qDebug() << "Checking range " << start << " - " << end;
+	qCDebug(qtspellCheck) << "Checking range " << start << " - " << end;
 
 	QTextCharFormat errorFmt;
 	errorFmt.setFontUnderline(true);
@@ -211,37 +1057,71 @@ void TextEditChecker::checkSpelling(int start, int end)
 	errorFmt.setUnderlineStyle(QTextCharFormat::WaveUnderline);
 	QTextCharFormat defaultFormat = QTextCharFormat();
 
-	TextCursor cursor(d->textEdit->textCursor());
+	// Words overlapping the range are checked as a whole, the range of the index follows them
+	int checkedStart = start;
+	int checkedEnd = end;
+	QTextCursor cursor(document);
 	cursor.beginEditBlock();
-	cursor.setPosition(start);
-	while(cursor.position() < end) {
-		cursor.moveWordEnd(QTextCursor::KeepAnchor);
-		bool correct;
-		QString word = cursor.selectedText();
-		if(d->noSpellingPropertySet(cursor)) {
-			correct = true;
-			qDebug() << "Skipping word:" << word << "(" << cursor.anchor() << "-" << cursor.position() << ")";
-		} else {
-			correct = checkWord(word);
-			qDebug() << "Checking word:" << word << "(" << cursor.anchor() << "-" << cursor.position() << "), correct:" << correct;
+	for(QTextBlock block = document->findBlock(start); block.isValid() && block.position() < end; block = block.next()) {
+		if(deferInvisibleBlocks && !block.isVisible()) {
+			// Folded block, check it once it is shown again
+			deferBlock(state, block);
+			continue;
 		}
-		if(!correct){
-			cursor.mergeCharFormat(errorFmt);
-		}else{
-			QTextCharFormat fmt = cursor.charFormat();
-			fmt.setFontUnderline(defaultFormat.fontUnderline());
-			fmt.setUnderlineColor(defaultFormat.underlineColor());
-			fmt.setUnderlineStyle(defaultFormat.underlineStyle());
-			cursor.setCharFormat(fmt);
-		}
-		// Go to next word start
-		while(cursor.position() < end && !cursor.isWordChar(cursor.nextChar())){
-			cursor.movePosition(QTextCursor::NextCharacter);
+		int blockPos = block.position();
+		QString text = block.text();
+		int wordStart, wordEnd;
+		int from = qMax(0, start - blockPos);
+		Tokenizer<> tokenizer(text, word_at(text, from, &wordStart, &wordEnd) ? wordStart : from);
+		while(tokenizer.next(&wordStart, &wordEnd) && blockPos + wordStart < end) {
+			cursor.setPosition(blockPos + wordStart);
+			cursor.setPosition(blockPos + wordEnd, QTextCursor::KeepAnchor);
+			checkedStart = qMin(checkedStart, blockPos + wordStart);
+			checkedEnd = qMax(checkedEnd, blockPos + wordEnd);
+			bool correct;
+			QString word = tokenizer.word(wordStart, wordEnd);
+			if(noSpellingPropertySet(cursor)) {
+				correct = true;
+				qCDebug(qtspellCheck) << "Skipping word:" << word << "(" << cursor.anchor() << "-" << cursor.position() << ")";
+			} else {
+				watch.startWord();
+				correct = q->checkWord(word);
+				watch.finishWord(word);
+				qCDebug(qtspellCheck) << "Checking word:" << word << "(" << cursor.anchor() << "-" << cursor.position() << "), correct:" << correct;
+			}
+			if(!correct){
+				cursor.mergeCharFormat(errorFmt);
+				trackUnderline(state, cursor.selectionStart(), cursor.selectionEnd());
+				if(state->misspellingIndexed){
+					Misspelling misspelling;
+					misspelling.start = cursor.selectionStart();
+					misspelling.end = cursor.selectionEnd();
+					misspelling.word = word;
+					found.append(misspelling);
+				}
+			}else{
+				QTextCharFormat fmt = cursor.charFormat();
+				fmt.setFontUnderline(defaultFormat.fontUnderline());
+				fmt.setUnderlineColor(defaultFormat.underlineColor());
+				fmt.setUnderlineStyle(defaultFormat.underlineStyle());
+				cursor.setCharFormat(fmt);
+			}
 		}
 	}
 	cursor.endEditBlock();
 
-	d->textEdit->document()->blockSignals(false);
+	if(suspendUndo){
+		document->setUndoRedoEnabled(true);
+	}
+	document->blockSignals(false);
+	if(state->misspellingIndexed){
+		indexMisspellings(state, checkedStart, checkedEnd, found);
+	}
+
+	statistics.lastCheckUsecs = timer.nsecsElapsed() / 1000;
+	statistics.totalCheckUsecs += statistics.lastCheckUsecs;
+	statistics.charactersChecked += end - start;
+	++statistics.checkCount;
 }
 
 bool TextEditCheckerPrivate::noSpellingPropertySet(const QTextCursor &cursor) const
@@ -262,36 +1142,169 @@ bool TextEditCheckerPrivate::noSpellingPropertySet(const QTextCursor &cursor) co
 	return false;
 }
 
+void TextEditCheckerPrivate::deferBlock(DocumentState* state, const QTextBlock& block)
+{
+	if(block.length() <= 1){
+		// Nothing to check in an empty block
+		return;
+	}
+	int start = block.position();
+	int end = start + block.length() - 1;
+	// Cursors follow the edits in order, so the runs stay sorted by position
+	QList<QTextCursor>& runs = state->deferredBlocks;
+	QList<QTextCursor>::iterator it = std::upper_bound(runs.begin(), runs.end(), start, [](int pos, const QTextCursor& run){ return pos < run.selectionStart(); });
+	if(it != runs.begin()){
+		QTextCursor& previous = *(it - 1);
+		if(previous.selectionEnd() >= end){
+			// Consecutive words of the same block end up here when a range starts inside it
+			return;
+		}
+		if(previous.selectionEnd() + 1 >= start){
+			previous.setPosition(previous.selectionStart());
+			previous.setPosition(end, QTextCursor::KeepAnchor);
+			return;
+		}
+	}
+	QTextCursor run(block);
+	run.setPosition(end, QTextCursor::KeepAnchor);
+	runs.insert(it, run);
+}
+
+void TextEditCheckerPrivate::checkRevealedBlocks(DocumentState* state, int from, int to)
+{
+	// Checking changes char formats, which triggers further layout updates
+	QList<QTextCursor>& runs = state->deferredBlocks;
+	if(runs.isEmpty() || checkingRevealedBlocks){
+		return;
+	}
+	checkingRevealedBlocks = true;
+	QTextDocument* doc = state->document;
+	int index = std::lower_bound(runs.begin(), runs.end(), from, [](const QTextCursor& run, int pos){ return run.selectionEnd() < pos; }) - runs.begin();
+	while(index < runs.size() && runs[index].selectionStart() <= to){
+		QTextCursor run = runs[index];
+		if(!run.hasSelection()){
+			// All blocks of the run were removed
+			runs.removeAt(index);
+			continue;
+		}
+		// Folds are shown and hidden as a whole, so the ends of a run tell whether it was revealed
+		if(deferInvisibleBlocks && !doc->findBlock(run.selectionStart()).isVisible() && !doc->findBlock(run.selectionEnd()).isVisible()){
+			++index;
+			continue;
+		}
+		runs.removeAt(index);
+		int count = runs.size();
+		// Blocks of the run which are still invisible are deferred again in place
+		checkSpelling(state, run.selectionStart(), run.selectionEnd());
+		index += runs.size() - count;
+	}
+	checkingRevealedBlocks = false;
+}
+
+void TextEditCheckerPrivate::indexMisspellings(DocumentState* state, int start, int end, const QList<Misspelling>& found)
+{
+	// Replace the entries of the checked range, the checks of a full pass mostly append
+	auto byStart = [](const Misspelling& misspelling, int pos){ return misspelling.start < pos; };
+	QList<Misspelling>& index = state->misspellingIndex;
+	QList<Misspelling>::iterator first = std::lower_bound(index.begin(), index.end(), start, byStart);
+	QList<Misspelling>::iterator last = std::lower_bound(first, index.end(), end, byStart);
+	int pos = index.erase(first, last) - index.begin();
+	for(const Misspelling& misspelling : found){
+		index.insert(pos++, misspelling);
+	}
+}
+
+void TextEditCheckerPrivate::clearMisspellingIndex(DocumentState* state)
+{
+	state->misspellingIndex.clear();
+	state->misspellingIndexed = false;
+}
+
+void TextEditCheckerPrivate::resetTextStatistics(DocumentState* state)
+{
+	Q_Q(TextEditChecker);
+	if(!state->textStatistics){
+		return;
+	}
+	state->textStatistics->reset(state->document);
+	emit q->textStatisticsChanged();
+}
+
+void TextEditCheckerPrivate::memoryUsage(MemoryUsage& usage) const
+{
+	CheckerPrivate::memoryUsage(usage);
+	for(const DocumentState* state : documents){
+		usage.undoStack += state->undoRedoStack ? state->undoRedoStack->memoryUsage() : 0;
+		// A QTextCursor is a pointer to a shared private holding the position and anchor
+		usage.documentIndexes += sizeof(DocumentState) + state->deferredBlocks.size() * (sizeof(QTextCursor) + 64);
+		for(const Misspelling& misspelling : state->misspellingIndex){
+			usage.documentIndexes += sizeof(Misspelling) + misspelling.word.capacity() * sizeof(QChar);
+		}
+		if(state->textStatistics){
+			usage.documentIndexes += state->textStatistics->memoryUsage();
+		}
+	}
+}
+
+int TextEditCheckerPrivate::pendingChecks() const
+{
+	int pending = 0;
+	for(const DocumentState* state : documents){
+		pending += state->deferredBlocks.size() + (state->checkScheduled ? 1 : 0) + (state->backgroundCheck && state->backgroundCheck->isRunning() ? 1 : 0);
+	}
+	return pending;
+}
+
 void TextEditChecker::clearUndoRedo()
 {
 	Q_D(TextEditChecker);
-	if(d->undoRedoStack){
-		d->undoRedoStack->clear();
+	TextEditProxy* textEdit = d->currentTextEdit();
+	DocumentState* state = textEdit ? d->documentState(textEdit->checkedDocument) : nullptr;
+	if(state && state->undoRedoStack){
+		state->undoRedoStack->clear();
 	}
 }
 
+const LatencyHistogram& TextEditChecker::keystrokeLatency() const
+{
+	Q_D(const TextEditChecker);
+	return d->keystrokeLatency;
+}
+
+void TextEditChecker::resetKeystrokeLatency()
+{
+	Q_D(TextEditChecker);
+	d->keystrokeLatency.reset();
+}
+
 void TextEditChecker::setUndoRedoEnabled(bool enabled)
 {
 	Q_D(TextEditChecker);
-	if(enabled == (d->undoRedoStack != nullptr)){
+	if(enabled == d->undoRedoEnabled){
 		return;
 	}
+	if(enabled && d->attachMode != ReadWriteMode){
+		return;
+	}
+	d->undoRedoEnabled = enabled;
+	for(DocumentState* state : qAsConst(d->documents)){
+		if(enabled){
+			d->createUndoRedoStack(state);
+		}else{
+			delete state->undoRedoStack;
+			state->undoRedoStack = nullptr;
+		}
+	}
 	if(!enabled){
-		delete d->undoRedoStack;
-		d->undoRedoStack = nullptr;
 		emit undoAvailable(false);
 		emit redoAvailable(false);
-	}else{
-		d->undoRedoStack = new UndoRedoStack(d->textEdit);
-		connect(d->undoRedoStack, &QtSpell::UndoRedoStack::undoAvailable, this, &TextEditChecker::undoAvailable);
-		connect(d->undoRedoStack, &QtSpell::UndoRedoStack::redoAvailable, this, &TextEditChecker::redoAvailable);
 	}
 }
 
 QString TextEditChecker::getWord(int pos, int* start, int* end) const
 {
 	Q_D(const TextEditChecker);
-	TextCursor cursor(d->textEdit->textCursor());
+	TextCursor cursor(d->currentDocument()->document);
 	cursor.setPosition(pos);
 	cursor.moveWordStart();
 	cursor.moveWordEnd(QTextCursor::KeepAnchor);
@@ -305,7 +1318,7 @@ QString TextEditChecker::getWord(int pos, int* start, int* end) const
 void TextEditChecker::insertWord(int start, int end, const QString &word)
 {
 	Q_D(TextEditChecker);
-	QTextCursor cursor(d->textEdit->textCursor());
+	QTextCursor cursor(d->currentDocument()->document);
 	cursor.setPosition(start);
 	cursor.movePosition(QTextCursor::NextCharacter, QTextCursor::KeepAnchor, end - start);
 	cursor.insertText(word);
@@ -314,54 +1327,114 @@ void TextEditChecker::insertWord(int start, int end, const QString &word)
 void TextEditChecker::slotShowContextMenu(const QPoint &pos)
 {
 	Q_D(TextEditChecker);
-	QPoint globalPos = d->textEdit->mapToGlobal(pos);
-	QMenu* menu = d->textEdit->createStandardContextMenu();
-	int wordPos = d->textEdit->cursorForPosition(pos).position();
-	showContextMenu(menu, globalPos, wordPos);
+	TextEditProxy* textEdit = qobject_cast<TextEditProxy*>(sender());
+	DocumentState* state = textEdit ? d->documentState(textEdit->checkedDocument) : nullptr;
+	if(!state){
+		return;
+	}
+	QPoint globalPos = textEdit->mapToGlobal(pos);
+	QMenu* menu = textEdit->createStandardContextMenu();
+	int wordPos = textEdit->cursorForPosition(pos).position();
+	// The owner underlines the document, so its language and spelling switch apply to the menu
+	TextEditChecker* owner = DocumentCheckers::owner(state->document);
+	QPointer<TextEditChecker> checker = owner ? owner : this;
+	// The word positions of the menu actions refer to the document of this widget
+	checker->d_func()->menuDocument = checker->d_func()->documentState(state->document);
+	checker->showContextMenu(menu, globalPos, wordPos);
+	if(checker){
+		checker->d_func()->menuDocument = nullptr;
+	}
 }
 
 void TextEditChecker::slotCheckDocumentChanged()
 {
 	Q_D(TextEditChecker);
-	if(d->document != d->textEdit->document()) {
-		bool undoWasEnabled = d->undoRedoStack != nullptr;
-		setUndoRedoEnabled(false);
-		if(d->document){
-			disconnect(d->document, &QTextDocument::contentsChange, this, &TextEditChecker::slotCheckRange);
+	TextEditProxy* textEdit = qobject_cast<TextEditProxy*>(sender());
+	if(!textEdit){
+		return;
+	}
+	if(textEdit->checkedDocument != textEdit->document()){
+		// The widget shows another document now
+		d->detachDocument(textEdit, true);
+		d->attachDocument(textEdit);
+		return;
+	}
+	DocumentState* state = d->documentState(textEdit->checkedDocument);
+	if(d->attachMode == ReadOnlyMode && state->textEdit == textEdit){
+		// Viewers replace their contents wholesale, just recheck once the dust settles.
+		// Edits are not tracked in this mode, recount the replaced contents.
+		d->resetTextStatistics(state);
+		d->clearMisspellingIndex(state);
+		if(d->isDocumentOwner(state->document)){
+			d->scheduleCheck(state);
 		}
-		d->document = d->textEdit->document();
-		connect(d->document, &QTextDocument::contentsChange, this, &TextEditChecker::slotCheckRange);
-		setUndoRedoEnabled(undoWasEnabled);
 	}
 }
 
 void TextEditChecker::slotDetachTextEdit()
 {
 	Q_D(TextEditChecker);
-	bool undoWasEnabled = d->undoRedoStack != nullptr;
-	setUndoRedoEnabled(false);
-	delete d->textEdit;
-	d->textEdit = nullptr;
-	d->document = nullptr;
-	if(undoWasEnabled){
-		// Crate dummy instance
-		setUndoRedoEnabled(true);
+	// The widget is gone, only its document may be left
+	if(TextEditProxy* textEdit = qobject_cast<TextEditProxy*>(sender())){
+		d->detachTextEdit(textEdit, false);
 	}
 }
 
 void TextEditChecker::slotCheckRange(int pos, int removed, int added)
 {
 	Q_D(TextEditChecker);
-	if(d->undoRedoStack != nullptr && !d->undoRedoInProgress){
-		d->undoRedoStack->handleContentsChange(pos, removed, added);
+	QElapsedTimer timer;
+	timer.start();
+	DocumentState* state = d->documentState(qobject_cast<QTextDocument*>(sender()));
+	if(!state){
+		return;
+	}
+	QTextDocument* document = state->document;
+
+	// Only the owner of the document records and checks the change, once for all views
+	bool documentOwner = d->isDocumentOwner(document);
+	if(documentOwner && state->undoRedoStack != nullptr && !state->undoRedoInProgress){
+		state->undoRedoStack->handleContentsChange(pos, removed, added);
 	}
 
 	// Qt Bug? Apparently, when contents is pasted at pos = 0, added and removed are too large by 1
-	TextCursor c(d->textEdit->textCursor());
+	TextCursor c(document);
 	c.movePosition(QTextCursor::End);
 	int len = c.position();
 	if(pos == 0 && added > len){
 		--added;
+		--removed;
+	}
+	if(state->undoRedoInProgress){
+		d->statistics.undoRedoCharacters += removed + added;
+	}
+	if(state->textStatistics && state->textStatistics->update(document, pos, added)){
+		emit textStatisticsChanged();
+	}
+
+	if(d->tracing(state) && !state->undoRedoInProgress){
+		c.setPosition(pos);
+		c.setPosition(pos + added, QTextCursor::KeepAnchor);
+		QString text = c.selectedText();
+		text.replace(QChar::ParagraphSeparator, '\n');
+		d->traceRecorder->recordEdit(pos, removed, text);
+	}
+
+	if(!documentOwner || d->highlighterActive(state)){
+		// Checked by the owner, or by the highlighter as part of its own pass
+		return;
+	}
+
+	if(d->attachMode == AppendOnlyMode){
+		if(removed > 0){
+			d->forgetRemovedBlocks(state, pos);
+		}
+		if(added > 0){
+			d->scheduleAppendCheck(state, pos, pos + added);
+			// Recorded together with the check of the pending changes
+			state->appendPendingUsecs += timer.nsecsElapsed() / 1000;
+		}
+		return;
 	}
 
 	// Set default format on inserted text
@@ -376,36 +1449,92 @@ void TextEditChecker::slotCheckRange(int pos, int removed, int added)
 	fmt.setUnderlineColor(defaultFormat.underlineColor());
 	fmt.setUnderlineStyle(defaultFormat.underlineStyle());
 	c.setCharFormat(fmt);
-	checkSpelling(c.anchor(), c.position());
+	d->checkSpelling(state, c.anchor(), c.position());
 	c.endEditBlock();
+
+	d->recordKeystrokeLatency(document, timer.nsecsElapsed() / 1000);
+}
+
+void TextEditChecker::slotScheduledCheck()
+{
+	Q_D(TextEditChecker);
+	for(int i = 0; i < d->documents.size(); ++i){
+		DocumentState* state = d->documents[i];
+		if(!state->checkScheduled){
+			continue;
+		}
+		state->checkScheduled = false;
+		if(d->attachMode != AppendOnlyMode){
+			d->checkSpelling(state, 0, -1);
+		}else if(!state->appendPending.isNull()){
+			int start = state->appendPending.selectionStart();
+			int end = state->appendPending.selectionEnd();
+			state->appendPending = QTextCursor();
+			QElapsedTimer timer;
+			timer.start();
+			d->checkSpelling(state, start, end);
+			d->recordKeystrokeLatency(state->document, state->appendPendingUsecs + timer.nsecsElapsed() / 1000);
+		}
+	}
+}
+
+void TextEditChecker::slotCheckRevealedBlocks(const QRectF& rect)
+{
+	Q_D(TextEditChecker);
+	QAbstractTextDocumentLayout* layout = qobject_cast<QAbstractTextDocumentLayout*>(sender());
+	DocumentState* state = layout ? d->documentState(layout->document()) : nullptr;
+	if(!state || state->deferredBlocks.isEmpty()){
+		return;
+	}
+	// Only blocks within the updated area can have been revealed
+	int from = layout->hitTest(rect.topLeft(), Qt::FuzzyHit);
+	int to = layout->hitTest(rect.bottomRight(), Qt::FuzzyHit);
+	if(from < 0 || to < 0){
+		// QPlainTextDocumentLayout does not map points to positions, look at all runs
+		from = 0;
+		to = INT_MAX;
+	}
+	d->checkRevealedBlocks(state, from, to);
+}
+
+void TextEditChecker::startTraceRecording(QIODevice* device)
+{
+	Q_D(TextEditChecker);
+	delete d->traceRecorder;
+	d->traceRecorder = new TraceRecorder(device);
+	TextEditProxy* textEdit = d->textEdits.value(0);
+	QString text = textEdit ? textEdit->document()->toPlainText() : QString();
+	QString widget = textEdit ? textEdit->widgetClassName() : QString();
+	d->traceRecorder->recordStart(widget, getLanguage(), text);
+}
+
+void TextEditChecker::stopTraceRecording()
+{
+	Q_D(TextEditChecker);
+	delete d->traceRecorder;
+	d->traceRecorder = nullptr;
 }
 
 void TextEditChecker::undo()
 {
 	Q_D(TextEditChecker);
-	if(d->undoRedoStack != nullptr){
-		d->undoRedoInProgress = true;
-		d->undoRedoStack->undo();
-		d->textEdit->ensureCursorVisible();
-		d->undoRedoInProgress = false;
+	if(TextEditProxy* textEdit = d->currentTextEdit()){
+		d->undoRedo(textEdit, false);
 	}
 }
 
 void TextEditChecker::redo()
 {
 	Q_D(TextEditChecker);
-	if(d->undoRedoStack != nullptr){
-		d->undoRedoInProgress = true;
-		d->undoRedoStack->redo();
-		d->textEdit->ensureCursorVisible();
-		d->undoRedoInProgress = false;
+	if(TextEditProxy* textEdit = d->currentTextEdit()){
+		d->undoRedo(textEdit, true);
 	}
 }
 
 bool TextEditChecker::isAttached() const
 {
 	Q_D(const TextEditChecker);
-	return d->textEdit != 0;
+	return !d->textEdits.isEmpty();
 }
 
 } // QtSpell
@@ -21,7 +21,12 @@
 
 #include "QtSpell.hpp"
 #include "Checker_p.hpp"
+#include "SyntaxHighlighter.hpp"
+#include "Tokenizer.hpp"
 
+#include <QHash>
+#include <QList>
+#include <QPointer>
 #include <QTextCursor>
 
 class QMenu;
@@ -29,29 +34,131 @@ class QTextDocument;
 
 namespace QtSpell {
 
+class BackgroundCheck;
 class TextEditChecker;
 class TextEditProxy;
+class TextStatisticsIndex;
 class UndoRedoStack;
 
+/**
+ * @brief The checking state of a document shown by the widgets of a
+ *        TextEditChecker, kept once even if several of them show it.
+ */
+struct DocumentState
+{
+	QTextDocument* document = nullptr;
+	// The widget whose cursor undo/redo moves, one of those showing the document
+	TextEditProxy* textEdit = nullptr;
+	UndoRedoStack* undoRedoStack = nullptr;
+	bool undoRedoInProgress = false;
+	bool checkScheduled = false;
+	QMetaObject::Connection contentsConnection;
+	QMetaObject::Connection layoutConnection;
+	// Runs of consecutive deferred blocks, each selecting the text of the run, in document order
+	QList<QTextCursor> deferredBlocks;
+	// ReadOnlyMode: the misspellings found by the checks since the last full check, in document order
+	QList<Misspelling> misspellingIndex;
+	bool misspellingIndexed = false;
+	// Spans all spelling underlines written into the document, follows edits
+	QTextCursor underlinedRange;
+	// AppendOnlyMode: selects the blocks changed since the last check
+	QTextCursor appendPending;
+	// AppendOnlyMode: the edit handling time spent on the pending changes so far
+	qint64 appendPendingUsecs = 0;
+	// Lightweight modes: whether the warning about an undo history kept by the document was issued
+	bool documentUndoWarned = false;
+	BackgroundCheck* backgroundCheck = nullptr;
+	TextStatisticsIndex* textStatistics = nullptr;
+};
+
 class TextEditCheckerPrivate : public CheckerPrivate
 {
 public:
 	TextEditCheckerPrivate();
 	virtual ~TextEditCheckerPrivate();
 
+	static TextEditCheckerPrivate* get(TextEditChecker* checker){ return checker->d_func(); }
+
 	void setTextEdit(TextEditProxy* newTextEdit);
+	void attachTextEdit(TextEditProxy* newTextEdit, int index);
+	void detachTextEdit(TextEditProxy* oldTextEdit, bool widgetAlive);
+	TextEditProxy* findTextEdit(const QObject* widget) const;
+	TextEditProxy* currentTextEdit() const;
+	void attachDocument(TextEditProxy* textEdit);
+	void detachDocument(TextEditProxy* textEdit, bool widgetAlive);
+	DocumentState* documentState(const QTextDocument* document) const;
+	DocumentState* textEditDocument(const QWidget* widget) const;
+	DocumentState* currentDocument() const;
+	bool tracing(const DocumentState* state) const;
+	bool isDocumentOwner(const QTextDocument* document) const;
+	void undoRedo(TextEditProxy* textEdit, bool redo);
+	void createUndoRedoStack(DocumentState* state);
+	void takeUndoRedoStack(DocumentState* state, DocumentState* previous);
+	void trackUnderline(DocumentState* state, int start, int end);
+	void clearSpellingFormat(DocumentState* state);
+	bool highlighterActive(const DocumentState* state) const;
+	void recordKeystrokeLatency(const QTextDocument* document, qint64 usecs);
+	void installEditHooks(TextEditProxy* textEdit);
+	void installEditHooks(DocumentState* state);
+	void removeEditHooks(TextEditProxy* textEdit);
+	void removeEditHooks(DocumentState* state);
+	void scheduleCheck(DocumentState* state);
+	void scheduleAppendCheck(DocumentState* state, int start, int end = -1);
+	void forgetRemovedBlocks(DocumentState* state, int pos);
+	void checkSpelling(DocumentState* state, int start, int end);
+	void replaceWords(DocumentState* state, const QList<QPair<Misspelling, QString>>& replacements);
+	QList<Misspelling> misspellings(const DocumentState* state, int start, int end) const;
+	QualityEstimate estimateQuality(const DocumentState* state, int budgetMsecs, int topWords) const;
 	bool noSpellingPropertySet(const QTextCursor& cursor) const;
-
-	TextEditProxy* textEdit = nullptr;
-	QTextDocument* document = nullptr;
-	UndoRedoStack* undoRedoStack = nullptr;
-	bool undoRedoInProgress = false;
-	Qt::ContextMenuPolicy oldContextMenuPolicy;
+	int blockMisspellings(const QTextBlock& block, int start, int end, QList<Misspelling>& result, OperationWatch* watch = nullptr) const;
+	void deferBlock(DocumentState* state, const QTextBlock& block);
+	void checkRevealedBlocks(DocumentState* state, int from, int to);
+	void indexMisspellings(DocumentState* state, int start, int end, const QList<Misspelling>& found);
+	void clearMisspellingIndex(DocumentState* state);
+	void resetTextStatistics(DocumentState* state);
+	virtual void memoryUsage(MemoryUsage& usage) const;
+	virtual int pendingChecks() const;
+	virtual void dictionaryChanged() const;
+
+	// The attached widgets, the one set with setTextEdit first
+	QList<TextEditProxy*> textEdits;
+	// The documents shown by the attached widgets
+	QList<DocumentState*> documents;
+	// The document of the context menu being shown, the positions of its actions refer to it
+	DocumentState* menuDocument = nullptr;
+	TextEditChecker::AttachMode attachMode = TextEditChecker::ReadWriteMode;
 	int noSpellingProperty = -1;
+	bool undoRedoEnabled = false;
+	bool textStatisticsEnabled = false;
+	bool deferInvisibleBlocks = false;
+	bool checkingRevealedBlocks = false;
+	LatencyHistogram keystrokeLatency;
+	QPointer<SyntaxHighlighter> highlighter;
 
 	Q_DECLARE_PUBLIC(TextEditChecker)
 };
 
+/**
+ * @brief Registry of the checkers attached to each document.
+ * @details Several views may show the same document, i.e. in split views.
+ *          The checking state is kept once per document by its owner, the
+ *          first attached read-write checker (or the first checker if all are
+ *          read-only): only the owner tokenizes and checks the document and
+ *          records the undo history, the other checkers forward to it and
+ *          only handle the context menu of their own view.
+ */
+class DocumentCheckers
+{
+public:
+	static void add(const QTextDocument* document, TextEditChecker* checker);
+	static void remove(const QTextDocument* document, TextEditChecker* checker);
+	static TextEditChecker* owner(const QTextDocument* document);
+	static QList<TextEditChecker*> checkers(const QTextDocument* document);
+
+private:
+	static QHash<const QTextDocument*, QList<TextEditChecker*>> s_checkers;
+};
+
 /**
  * @brief An enhanced QTextCursor
  */
@@ -59,60 +166,29 @@ class TextCursor : public QTextCursor
 {
 public:
 	TextCursor()
-		: QTextCursor(), m_wordRegEx(QRegExp("^\\w$")) {}
+		: QTextCursor() {}
 	TextCursor(QTextDocument* document)
-		: QTextCursor(document), m_wordRegEx(QRegExp("^\\w$")) {}
+		: QTextCursor(document) {}
 	TextCursor(const QTextBlock& block)
-		: QTextCursor(block), m_wordRegEx(QRegExp("^\\w$")) {}
+		: QTextCursor(block) {}
 	TextCursor(const QTextCursor& cursor)
-		: QTextCursor(cursor), m_wordRegEx(QRegExp("^\\w$")) {}
-
-	/**
-	 * @brief Retreive the num-th next character.
-	 * @param num Which character to retreive.
-	 * @return A string containing the character, might be empty.
-	 */
-	QString nextChar(int num = 1) const;
+		: QTextCursor(cursor) {}
 
 	/**
-	 * @brief Retreive the num-th previous character.
-	 * @param num Which character to retreive.
-	 * @return A string containing the character, might be empty.
-	 */
-	QString prevChar(int num = 1) const;
-
-	/**
-	 * @brief Move the cursor to the start of the current word. Cursor must be
-	 *        inside a word. This method correctly honours apostrophes.
+	 * @brief Move the cursor to the start of the word it is in or next to,
+	 *        by the word boundaries of QtSpell::Tokenizer<>. Outside of words
+	 *        the cursor stays where it is.
 	 * @param moveMode The move mode, see QTextCursor::MoveMode.
 	 */
 	void moveWordStart(MoveMode moveMode = MoveAnchor);
 
 	/**
-	 * @brief Move the cursor to the end of the current word. Cursor must be
-	 *        inside a word. This method correctly honours apostrophes.
+	 * @brief Move the cursor to the end of the word it is in or next to, by
+	 *        the word boundaries of QtSpell::Tokenizer<>. Outside of words
+	 *        the cursor stays where it is.
 	 * @param moveMode The move mode, see QTextCursor::MoveMode.
 	 */
 	void moveWordEnd(MoveMode moveMode = MoveAnchor);
-
-	/**
-	 * @brief Returns whether the cursor is inside a word.
-	 * @return Whether the cursor is inside a word.
-	 */
-	bool isInsideWord() const{
-		return nextChar().contains(m_wordRegEx) || prevChar().contains(m_wordRegEx);
-	}
-
-	/**
-	 * @brief Returns whether the specified character is a word character.
-	 * @return Whether the specified character is a word character.
-	 */
-	bool isWordChar(const QString& character) const{
-		return character.contains(m_wordRegEx);
-	}
-
-private:
-	QRegExp m_wordRegEx;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -129,10 +205,17 @@ public:
 	virtual void setContextMenuPolicy(Qt::ContextMenuPolicy policy) = 0;
 	virtual void setTextCursor(const QTextCursor& cursor) = 0;
 	virtual Qt::ContextMenuPolicy contextMenuPolicy() const = 0;
+	virtual QWidget* widget() const = 0;
+	virtual const char* widgetClassName() const = 0;
 	virtual void installEventFilter(QObject* filterObj) = 0;
 	virtual void removeEventFilter(QObject* filterObj) = 0;
 	virtual void ensureCursorVisible() = 0;
 
+	// Kept by TextEditCheckerPrivate: the document checked for the widget, and the context
+	// menu policy of the widget before the checker took over the context menu
+	QTextDocument* checkedDocument = nullptr;
+	Qt::ContextMenuPolicy oldContextMenuPolicy = Qt::DefaultContextMenu;
+
 signals:
 	void customContextMenuRequested(const QPoint& pos);
 	void textChanged();
@@ -155,6 +238,8 @@ public:
 	void setContextMenuPolicy(Qt::ContextMenuPolicy policy){ m_textEdit->setContextMenuPolicy(policy); }
 	void setTextCursor(const QTextCursor& cursor){ m_textEdit->setTextCursor(cursor); }
 	Qt::ContextMenuPolicy contextMenuPolicy() const{ return m_textEdit->contextMenuPolicy(); }
+	QWidget* widget() const{ return m_textEdit; }
+	const char* widgetClassName() const{ return T::staticMetaObject.className(); }
 	void installEventFilter(QObject* filterObj){ m_textEdit->installEventFilter(filterObj); }
 	void removeEventFilter(QObject* filterObj){ m_textEdit->removeEventFilter(filterObj); }
 	void ensureCursorVisible() { m_textEdit->ensureCursorVisible(); }
@@ -0,0 +1,168 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "TextStatisticsIndex.hpp"
+#include "Tokenizer.hpp"
+
+#include <QSet>
+#include <QTextBlock>
+#include <QTextDocument>
+
+namespace QtSpell {
+
+int TextStatistics::readingTimeSecs(int wordsPerMinute) const
+{
+	return wordsPerMinute > 0 ? int(qint64(words) * 60 / wordsPerMinute) : 0;
+}
+
+void TextStatisticsIndex::reset(const QTextDocument* document)
+{
+	clear();
+	m_blocks.reserve(document->blockCount());
+	for(QTextBlock block = document->begin(); block.isValid(); block = block.next()){
+		m_blocks.append(countBlock(block));
+	}
+}
+
+void TextStatisticsIndex::clear()
+{
+	m_blocks.clear();
+	m_wordRefs.clear();
+	m_totals = TextStatistics();
+}
+
+bool TextStatisticsIndex::update(const QTextDocument* document, int pos, int added)
+{
+	TextStatistics old = m_totals;
+	// Blocks before the change keep their numbers, blocks after it are shifted by delta
+	int delta = document->blockCount() - m_blocks.size();
+	QTextBlock first = document->findBlock(pos);
+	QTextBlock last = document->findBlock(pos + added);
+	if(!last.isValid()){
+		last = document->lastBlock();
+	}
+	int firstNumber = first.isValid() ? first.blockNumber() : 0;
+	int oldLastNumber = last.blockNumber() - delta;
+	if(firstNumber > m_blocks.size() || oldLastNumber >= m_blocks.size() || oldLastNumber < firstNumber - 1){
+		reset(document);
+	}else{
+		for(int i = firstNumber; i <= oldLastNumber; ++i){
+			removeBlock(m_blocks[i]);
+		}
+		QVector<BlockStats> counted;
+		for(QTextBlock block = document->findBlockByNumber(firstNumber); block.isValid(); block = block.next()){
+			counted.append(countBlock(block));
+			if(block == last){
+				break;
+			}
+		}
+		// Replace in place where possible, only a changed block count moves the tail
+		int replaced = qMin(counted.size(), oldLastNumber - firstNumber + 1);
+		for(int i = 0; i < replaced; ++i){
+			m_blocks[firstNumber + i] = counted[i];
+		}
+		if(counted.size() > replaced){
+			m_blocks.insert(firstNumber + replaced, counted.size() - replaced, BlockStats());
+			for(int i = replaced; i < counted.size(); ++i){
+				m_blocks[firstNumber + i] = counted[i];
+			}
+		}else{
+			m_blocks.remove(firstNumber + replaced, oldLastNumber - firstNumber + 1 - replaced);
+		}
+	}
+	return m_totals.words != old.words || m_totals.uniqueWords != old.uniqueWords ||
+	       m_totals.characters != old.characters || m_totals.paragraphs != old.paragraphs;
+}
+
+TextStatisticsIndex::BlockStats TextStatisticsIndex::countBlock(const QTextBlock& block)
+{
+	BlockStats stats;
+	QString text = block.text();
+	stats.characters = text.length();
+	QSet<QString> seen;
+	Tokenizer<> tokenizer(text);
+	int start, end;
+	while(tokenizer.next(&start, &end)){
+		++stats.words;
+		QString word = tokenizer.word(start, end).toLower();
+		if(seen.contains(word)){
+			continue;
+		}
+		seen.insert(word);
+		QHash<QString, int>::iterator it = m_wordRefs.find(word);
+		if(it == m_wordRefs.end()){
+			it = m_wordRefs.insert(word, 0);
+		}
+		++it.value();
+		stats.uniqueWords.append(it.key());
+	}
+	m_totals.words += stats.words;
+	m_totals.characters += stats.characters;
+	m_totals.paragraphs += stats.words > 0 ? 1 : 0;
+	m_totals.uniqueWords = m_wordRefs.size();
+	return stats;
+}
+
+void TextStatisticsIndex::removeBlock(const BlockStats& stats)
+{
+	for(const QString& word : stats.uniqueWords){
+		QHash<QString, int>::iterator it = m_wordRefs.find(word);
+		if(it != m_wordRefs.end() && --it.value() == 0){
+			m_wordRefs.erase(it);
+		}
+	}
+	m_totals.words -= stats.words;
+	m_totals.characters -= stats.characters;
+	m_totals.paragraphs -= stats.words > 0 ? 1 : 0;
+	m_totals.uniqueWords = m_wordRefs.size();
+}
+
+qint64 TextStatisticsIndex::memoryUsage() const
+{
+	// A QString is a pointer to a shared header of 24 bytes followed by the UTF-16 data
+	qint64 usage = m_blocks.capacity() * sizeof(BlockStats);
+	for(const BlockStats& stats : m_blocks){
+		usage += stats.uniqueWords.size() * sizeof(void*);
+	}
+	for(QHash<QString, int>::const_iterator it = m_wordRefs.constBegin(), itEnd = m_wordRefs.constEnd(); it != itEnd; ++it){
+		usage += 24 + 2 * it.key().size() + 32;
+	}
+	return usage;
+}
+
+TextStatistics TextStatisticsIndex::combined(const QList<const TextStatisticsIndex*>& indexes)
+{
+	if(indexes.size() == 1){
+		return indexes.first()->totals();
+	}
+	TextStatistics totals;
+	QSet<QString> uniqueWords;
+	for(const TextStatisticsIndex* index : indexes){
+		totals.words += index->m_totals.words;
+		totals.characters += index->m_totals.characters;
+		totals.paragraphs += index->m_totals.paragraphs;
+		for(QHash<QString, int>::const_iterator it = index->m_wordRefs.constBegin(), itEnd = index->m_wordRefs.constEnd(); it != itEnd; ++it){
+			uniqueWords.insert(it.key());
+		}
+	}
+	totals.uniqueWords = uniqueWords.size();
+	return totals;
+}
+
+} // QtSpell
@@ -0,0 +1,84 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef QTSPELL_TEXTSTATISTICSINDEX_HPP
+#define QTSPELL_TEXTSTATISTICSINDEX_HPP
+
+#include "QtSpell.hpp"
+
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+class QTextBlock;
+class QTextDocument;
+
+namespace QtSpell {
+
+/**
+ * @brief Word counts of a document, kept per block so that an edit only
+ *        recounts the blocks it touched.
+ */
+class TextStatisticsIndex
+{
+public:
+	/**
+	 * @brief Count the whole document.
+	 */
+	void reset(const QTextDocument* document);
+
+	/**
+	 * @brief Drop all counts.
+	 */
+	void clear();
+
+	/**
+	 * @brief Recount the blocks touched by a QTextDocument::contentsChange.
+	 * @return Whether the totals changed.
+	 */
+	bool update(const QTextDocument* document, int pos, int added);
+
+	const TextStatistics& totals() const{ return m_totals; }
+	qint64 memoryUsage() const;
+
+	/**
+	 * @brief Sum up the totals of several documents, counting words shared
+	 *        by them as distinct only once.
+	 */
+	static TextStatistics combined(const QList<const TextStatisticsIndex*>& indexes);
+
+private:
+	struct BlockStats {
+		int words = 0;
+		int characters = 0;
+		// The distinct lower case words, sharing the keys of m_wordRefs
+		QStringList uniqueWords;
+	};
+
+	QVector<BlockStats> m_blocks;
+	QHash<QString, int> m_wordRefs;
+	TextStatistics m_totals;
+
+	BlockStats countBlock(const QTextBlock& block);
+	void removeBlock(const BlockStats& stats);
+};
+
+} // QtSpell
+
+#endif // QTSPELL_TEXTSTATISTICSINDEX_HPP
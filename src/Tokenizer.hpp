@@ -0,0 +1,255 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef QTSPELL_TOKENIZER_HPP
+#define QTSPELL_TOKENIZER_HPP
+
+#include <QByteArray>
+#include <QChar>
+#include <QString>
+#include <QStringView>
+
+namespace QtSpell {
+
+/**
+ * @brief Character class policy: the characters matched by \w, that is
+ *        letters, numbers, marks and the underscore.
+ */
+struct UnicodeWordChars {
+	static bool isWordChar(uint ucs4){
+		if(ucs4 < 0x80){
+			return ucs4 - '0' < 10u || (ucs4 | 0x20) - 'a' < 26u || ucs4 == '_';
+		}
+		return QChar::isLetterOrNumber(ucs4) || QChar::isMark(ucs4);
+	}
+};
+
+/**
+ * @brief Character class policy: ASCII letters, digits and the underscore.
+ */
+struct AsciiWordChars {
+	static bool isWordChar(uint ucs4){
+		return ucs4 - '0' < 10u || (ucs4 | 0x20) - 'a' < 26u || ucs4 == '_';
+	}
+};
+
+/**
+ * @brief Punctuation policy: words never contain punctuation.
+ */
+struct NoJoiners {
+	static bool isJoiner(uint /*ucs4*/){ return false; }
+};
+
+/**
+ * @brief Punctuation policy: an apostrophe between word characters belongs to
+ *        the word, as in "don't".
+ */
+struct ApostropheJoiners {
+	static bool isJoiner(uint ucs4){ return ucs4 == '\''; }
+};
+
+/**
+ * @brief Punctuation policy: apostrophes and hyphens between word characters
+ *        belong to the word, as in "mother-in-law's".
+ */
+struct ApostropheHyphenJoiners {
+	static bool isJoiner(uint ucs4){ return ucs4 == '\'' || ucs4 == '-'; }
+};
+
+/**
+ * @brief A non-owning view of UTF-8 encoded text.
+ */
+class Utf8View {
+public:
+	Utf8View(const char* data, int size) : m_data(data), m_size(size) {}
+	Utf8View(const QByteArray& bytes) : m_data(bytes.constData()), m_size(bytes.size()) {}
+
+	const char* data() const{ return m_data; }
+	int size() const{ return m_size; }
+
+private:
+	const char* m_data;
+	int m_size;
+};
+
+/**
+ * @brief Access to the code points of a text storage type. Positions are in
+ *        code units of the storage (UTF-16 units or bytes).
+ */
+template<class Storage>
+struct TextTraits;
+
+template<>
+struct TextTraits<QStringView> {
+	static int size(QStringView text){ return int(text.size()); }
+
+	/**
+	 * @brief Decode the code point at pos and advance pos past it.
+	 */
+	static uint decode(QStringView text, int& pos){
+		QChar c = text[pos++];
+		if(c.isHighSurrogate() && pos < int(text.size()) && text[pos].isLowSurrogate()){
+			return QChar::surrogateToUcs4(c, text[pos++]);
+		}
+		return c.unicode();
+	}
+
+	static QString toString(QStringView text, int start, int length){
+		return text.mid(start, length).toString();
+	}
+};
+
+template<>
+struct TextTraits<Utf8View> {
+	static int size(Utf8View text){ return text.size(); }
+
+	/**
+	 * @brief Decode the code point at pos and advance pos past it. Malformed
+	 *        sequences decode to U+FFFD, one byte at a time.
+	 */
+	static uint decode(Utf8View text, int& pos){
+		const uchar* data = reinterpret_cast<const uchar*>(text.data());
+		uint c = data[pos++];
+		if(c < 0x80){
+			return c;
+		}
+		int count = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC2 ? 1 : 0;
+		if(count == 0 || c > 0xF4 || pos + count > text.size()){
+			return QChar::ReplacementCharacter;
+		}
+		uint ucs4 = c & (0x3F >> count);
+		for(int i = 0; i < count; ++i){
+			uint next = data[pos + i];
+			if((next & 0xC0) != 0x80){
+				return QChar::ReplacementCharacter;
+			}
+			ucs4 = (ucs4 << 6) | (next & 0x3F);
+		}
+		static const uint minimum[] = {0, 0x80, 0x800, 0x10000};
+		if(ucs4 < minimum[count] || ucs4 > 0x10FFFF || (ucs4 >= 0xD800 && ucs4 < 0xE000)){
+			return QChar::ReplacementCharacter;
+		}
+		pos += count;
+		return ucs4;
+	}
+
+	static QString toString(Utf8View text, int start, int length){
+		return QString::fromUtf8(text.data() + start, length);
+	}
+};
+
+/**
+ * @brief Splits text into words.
+ *
+ * The policies are resolved at compile time, so each combination is a
+ * specialized, inlined scanning loop:
+ * - CharClass provides <tt>static bool isWordChar(uint ucs4)</tt>
+ * - Joiners provides <tt>static bool isJoiner(uint ucs4)</tt>, the
+ *   punctuation which belongs to a word when followed by a word character
+ * - Storage is the text type, QStringView or Utf8View, see TextTraits
+ *
+ * The defaults are the word boundaries by which QtSpell::TextEditChecker
+ * checks, underlines and lists misspellings.
+ * Usage:
+ * @code
+ * QtSpell::Tokenizer<> tokenizer(text);
+ * int start, end;
+ * while(tokenizer.next(&start, &end)){
+ *     checker->checkWord(tokenizer.word(start, end));
+ * }
+ * @endcode
+ */
+template<class CharClass = UnicodeWordChars, class Joiners = ApostropheJoiners, class Storage = QStringView>
+class Tokenizer {
+public:
+	typedef TextTraits<Storage> Traits;
+
+	/**
+	 * @brief Tokenize text, starting at the specified position.
+	 * @param text The text, which must outlive the tokenizer.
+	 * @param pos The start position, in code units of the storage.
+	 */
+	explicit Tokenizer(Storage text, int pos = 0) : m_text(text), m_pos(pos) {}
+
+	/**
+	 * @brief Find the next word.
+	 * @param start Receives the position of the first character of the word.
+	 * @param end Receives the position past the last character of the word.
+	 * @return Whether a word was found, false at the end of the text.
+	 */
+	bool next(int* start, int* end){
+		const int size = Traits::size(m_text);
+		int wordStart = -1;
+		while(m_pos < size){
+			int pos = m_pos;
+			if(CharClass::isWordChar(Traits::decode(m_text, m_pos))){
+				wordStart = pos;
+				break;
+			}
+		}
+		if(wordStart < 0){
+			return false;
+		}
+		while(m_pos < size){
+			int pos = m_pos;
+			uint c = Traits::decode(m_text, pos);
+			if(CharClass::isWordChar(c)){
+				m_pos = pos;
+			}else if(Joiners::isJoiner(c) && pos < size && CharClass::isWordChar(Traits::decode(m_text, pos))){
+				m_pos = pos;
+			}else{
+				break;
+			}
+		}
+		*start = wordStart;
+		*end = m_pos;
+		return true;
+	}
+
+	/**
+	 * @brief Returns the text between start and end as a string.
+	 */
+	QString word(int start, int end) const{
+		return Traits::toString(m_text, start, end - start);
+	}
+
+	/**
+	 * @brief Returns the current position, in code units of the storage.
+	 */
+	int position() const{ return m_pos; }
+
+	/**
+	 * @brief Returns whether the character is a word character.
+	 */
+	static bool isWordChar(uint ucs4){ return CharClass::isWordChar(ucs4); }
+
+	/**
+	 * @brief Returns whether the character belongs to a word when followed by
+	 *        a word character.
+	 */
+	static bool isJoiner(uint ucs4){ return Joiners::isJoiner(ucs4); }
+
+private:
+	Storage m_text;
+	int m_pos;
+};
+
+} // QtSpell
+
+#endif // QTSPELL_TOKENIZER_HPP
@@ -0,0 +1,104 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "TraceRecorder.hpp"
+
+#include <QIODevice>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QKeyEvent>
+
+namespace QtSpell {
+
+TraceRecorder::TraceRecorder(QIODevice* device)
+	: m_device(device)
+{
+	m_timer.start();
+}
+
+void TraceRecorder::recordStart(const QString& widget, const QString& lang, const QString& text)
+{
+	QJsonObject event;
+	event["type"] = "start";
+	event["version"] = FormatVersion;
+	event["widget"] = widget;
+	event["language"] = lang;
+	event["text"] = text;
+	write(event);
+}
+
+void TraceRecorder::recordKey(const QKeyEvent* keyEvent)
+{
+	QJsonObject event;
+	event["type"] = "key";
+	event["key"] = keyEvent->key();
+	event["modifiers"] = int(keyEvent->modifiers());
+	event["text"] = keyEvent->text();
+	write(event);
+	if(keyEvent->matches(QKeySequence::Paste)){
+		m_editCause = "paste";
+	}
+}
+
+void TraceRecorder::recordEdit(int pos, int removed, const QString& text)
+{
+	QJsonObject event;
+	event["type"] = "edit";
+	event["pos"] = pos;
+	event["removed"] = removed;
+	event["text"] = text;
+	if(m_editCause){
+		event["cause"] = m_editCause;
+	}else{
+		event["cause"] = removed + text.length() <= 1 ? "typing" : "edit";
+	}
+	m_editCause = nullptr;
+	write(event);
+}
+
+void TraceRecorder::recordAction(const char* type)
+{
+	QJsonObject event;
+	event["type"] = type;
+	write(event);
+}
+
+void TraceRecorder::recordWord(const char* type, const QString& word, int start, int end)
+{
+	QJsonObject event;
+	event["type"] = type;
+	event["word"] = word;
+	if(start >= 0){
+		// The range which is rechecked afterwards
+		event["start"] = start;
+		event["end"] = end;
+	}
+	write(event);
+}
+
+void TraceRecorder::write(QJsonObject& event)
+{
+	if(!m_device){
+		return;
+	}
+	event["t"] = m_timer.elapsed();
+	m_device->write(QJsonDocument(event).toJson(QJsonDocument::Compact));
+	m_device->write("\n");
+}
+
+} // QtSpell
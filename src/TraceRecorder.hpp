@@ -0,0 +1,66 @@
+/* QtSpell - Spell checking for Qt text widgets.
+ * Copyright (c) 2014 Sandro Mani
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License along
+ *    with this program; if not, write to the Free Software Foundation, Inc.,
+ *    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef QTSPELL_TRACERECORDER_HPP
+#define QTSPELL_TRACERECORDER_HPP
+
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QString>
+
+class QIODevice;
+class QJsonObject;
+class QKeyEvent;
+
+namespace QtSpell {
+
+/**
+ * @brief Writes a trace of an editing session as JSON lines, one event per
+ *        line, each with its offset from the start of the recording in
+ *        milliseconds in "t".
+ */
+class TraceRecorder
+{
+public:
+	static const int FormatVersion = 1;
+
+	TraceRecorder(QIODevice* device);
+
+	void recordStart(const QString& widget, const QString& lang, const QString& text);
+	void recordKey(const QKeyEvent* event);
+	void recordEdit(int pos, int removed, const QString& text);
+	void recordAction(const char* type);
+	void recordWord(const char* type, const QString& word, int start = -1, int end = -1);
+
+	/**
+	 * @brief Tag the next recorded edit with the specified cause, i.e.
+	 *        "paste" or "replace".
+	 */
+	void setEditCause(const char* cause){ m_editCause = cause; }
+
+private:
+	QPointer<QIODevice> m_device;
+	QElapsedTimer m_timer;
+	const char* m_editCause = nullptr;
+
+	void write(QJsonObject& event);
+};
+
+} // QtSpell
+
+#endif // QTSPELL_TRACERECORDER_HPP
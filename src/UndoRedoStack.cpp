@@ -57,6 +57,14 @@ struct UndoRedoStack::UndoableDelete : public UndoRedoStack::Action {
 	}
 };
 
+struct UndoRedoStack::UndoableGroup : public UndoRedoStack::Action {
+	QList<Action*> actions;
+
+	~UndoableGroup(){
+		qDeleteAll(actions);
+	}
+};
+
 UndoRedoStack::UndoRedoStack(TextEditProxy* textEdit)
 	: m_textEdit(textEdit)
 {
@@ -68,6 +76,8 @@ UndoRedoStack::UndoRedoStack(TextEditProxy* textEdit)
 
 void UndoRedoStack::clear()
 {
+	delete m_group;
+	m_group = nullptr;
 	qDeleteAll(m_undoStack);
 	qDeleteAll(m_redoStack);
 	m_undoStack.clear();
@@ -76,6 +86,62 @@ void UndoRedoStack::clear()
 	emit redoAvailable(false);
 }
 
+qint64 UndoRedoStack::memoryUsage() const
+{
+	qint64 usage = 0;
+	const QStack<Action*>* stacks[] = {&m_undoStack, &m_redoStack};
+	for(const QStack<Action*>* stack : stacks){
+		usage += stack->capacity() * sizeof(Action*);
+		foreach(const Action* action, *stack){
+			usage += actionMemoryUsage(action);
+		}
+	}
+	return usage;
+}
+
+qint64 UndoRedoStack::actionMemoryUsage(const Action* action) const
+{
+	if(const UndoableInsert* insertAction = dynamic_cast<const UndoableInsert*>(action)){
+		return sizeof(UndoableInsert) - sizeof(QString) + stringMemoryUsage(insertAction->text);
+	}else if(const UndoableDelete* deleteAction = dynamic_cast<const UndoableDelete*>(action)){
+		return sizeof(UndoableDelete) - sizeof(QString) + stringMemoryUsage(deleteAction->text);
+	}
+	const UndoableGroup* group = static_cast<const UndoableGroup*>(action);
+	qint64 usage = sizeof(UndoableGroup) + group->actions.size() * sizeof(Action*);
+	foreach(const Action* groupAction, group->actions){
+		usage += actionMemoryUsage(groupAction);
+	}
+	return usage;
+}
+
+void UndoRedoStack::beginGroup()
+{
+	if(!m_group){
+		m_group = new UndoableGroup;
+	}
+}
+
+void UndoRedoStack::endGroup()
+{
+	UndoableGroup* group = m_group;
+	m_group = nullptr;
+	if(group && !group->actions.isEmpty()){
+		m_undoStack.push(group);
+		emit undoAvailable(true);
+	}else{
+		delete group;
+	}
+}
+
+void UndoRedoStack::pushAction(Action* action)
+{
+	if(m_group){
+		m_group->actions.append(action);
+	}else{
+		m_undoStack.push(action);
+	}
+}
+
 void UndoRedoStack::handleContentsChange(int pos, int removed, int added)
 {
 	if(m_actionInProgress || (added == 0 && removed == 0)){
@@ -89,6 +155,7 @@ void UndoRedoStack::handleContentsChange(int pos, int removed, int added)
 		--added;
 		--removed;
 	}
+	qCDebug(qtspellUndo) << "Recording change at" << pos << "removed:" << removed << "added:" << added;
 	qDeleteAll(m_redoStack);
 	m_redoStack.clear();
 	if(removed > 0){
@@ -98,8 +165,8 @@ void UndoRedoStack::handleContentsChange(int pos, int removed, int added)
 		c.setPosition(pos + removed, QTextCursor::KeepAnchor);
 		UndoableDelete* undoAction = new UndoableDelete(pos, pos + removed, c.selectedText(), deleteWasUsed);
 		m_textEdit->document()->redo();
-		if(m_undoStack.empty() || !dynamic_cast<UndoableDelete*>(m_undoStack.top())){
-			m_undoStack.push(undoAction);
+		if(m_group || m_undoStack.empty() || !dynamic_cast<UndoableDelete*>(m_undoStack.top())){
+			pushAction(undoAction);
 		}else{
 			UndoableDelete* prevDelete = static_cast<UndoableDelete*>(m_undoStack.top());
 			if(deleteMergeable(prevDelete, undoAction)){
@@ -111,7 +178,7 @@ void UndoRedoStack::handleContentsChange(int pos, int removed, int added)
 					prevDelete->start = undoAction->start;
 				}
 			}else{
-				m_undoStack.push(undoAction);
+				pushAction(undoAction);
 			}
 		}
 	}
@@ -120,14 +187,14 @@ void UndoRedoStack::handleContentsChange(int pos, int removed, int added)
 		c.setPosition(pos);
 		c.setPosition(pos + added, QTextCursor::KeepAnchor);
 		UndoableInsert* undoAction = new UndoableInsert(pos, c.selectedText());
-		if(m_undoStack.empty() || !dynamic_cast<UndoableInsert*>(m_undoStack.top())){
-			m_undoStack.push(undoAction);
+		if(m_group || m_undoStack.empty() || !dynamic_cast<UndoableInsert*>(m_undoStack.top())){
+			pushAction(undoAction);
 		}else{
 			UndoableInsert* prevInsert = static_cast<UndoableInsert*>(m_undoStack.top());
 			if(insertMergeable(prevInsert, undoAction)){
 				prevInsert->text += undoAction->text;
 			}else{
-				m_undoStack.push(undoAction);
+				pushAction(undoAction);
 			}
 		}
 	}
@@ -144,23 +211,12 @@ void UndoRedoStack::undo()
 	if(m_undoStack.empty()){
 		return;
 	}
+	qCDebug(qtspellUndo) << "Undo, remaining steps:" << m_undoStack.size() - 1;
 	m_actionInProgress = true;
-	Action* undoAction = m_undoStack.pop();
-	m_redoStack.push(undoAction);
+	Action* action = m_undoStack.pop();
+	m_redoStack.push(action);
 	QTextCursor c(m_textEdit->textCursor());
-	if(dynamic_cast<UndoableInsert*>(undoAction)){
-		UndoableInsert* insertAction = static_cast<UndoableInsert*>(undoAction);
-		c.setPosition(insertAction->pos);
-		c.setPosition(insertAction->pos + insertAction->text.length(), QTextCursor::KeepAnchor);
-		c.removeSelectedText();
-	}else{
-		UndoableDelete* deleteAction = static_cast<UndoableDelete*>(undoAction);
-		c.setPosition(deleteAction->start);
-		c.insertText(deleteAction->text);
-		if(deleteAction->deleteKeyUsed){
-			c.setPosition(deleteAction->start);
-		}
-	}
+	undoAction(action, c);
 	m_textEdit->setTextCursor(c);
 	emit undoAvailable(!m_undoStack.empty());
 	emit redoAvailable(!m_redoStack.empty());
@@ -172,25 +228,58 @@ void UndoRedoStack::redo()
 	if(m_redoStack.empty()){
 		return;
 	}
+	qCDebug(qtspellUndo) << "Redo, remaining steps:" << m_redoStack.size() - 1;
 	m_actionInProgress = true;
-	Action* redoAction = m_redoStack.top();
+	Action* action = m_redoStack.top();
 	m_redoStack.pop();
-	m_undoStack.push(redoAction);
+	m_undoStack.push(action);
 	QTextCursor c(m_textEdit->textCursor());
-	if(dynamic_cast<UndoableInsert*>(redoAction)){
-		UndoableInsert* insertAction = static_cast<UndoableInsert*>(redoAction);
+	redoAction(action, c);
+	m_textEdit->setTextCursor(c);
+	emit undoAvailable(!m_undoStack.empty());
+	emit redoAvailable(!m_redoStack.empty());
+	m_actionInProgress = false;
+}
+
+void UndoRedoStack::undoAction(Action* action, QTextCursor& c)
+{
+	if(dynamic_cast<UndoableInsert*>(action)){
+		UndoableInsert* insertAction = static_cast<UndoableInsert*>(action);
 		c.setPosition(insertAction->pos);
-		c.insertText(insertAction->text);
+		c.setPosition(insertAction->pos + insertAction->text.length(), QTextCursor::KeepAnchor);
+		c.removeSelectedText();
+	}else if(dynamic_cast<UndoableDelete*>(action)){
+		UndoableDelete* deleteAction = static_cast<UndoableDelete*>(action);
+		c.setPosition(deleteAction->start);
+		c.insertText(deleteAction->text);
+		if(deleteAction->deleteKeyUsed){
+			c.setPosition(deleteAction->start);
+		}
 	}else{
-		UndoableDelete* deleteAction = static_cast<UndoableDelete*>(redoAction);
+		UndoableGroup* group = static_cast<UndoableGroup*>(action);
+		for(int i = group->actions.size() - 1; i >= 0; --i){
+			undoAction(group->actions[i], c);
+		}
+	}
+}
+
+void UndoRedoStack::redoAction(Action* action, QTextCursor& c)
+{
+	if(dynamic_cast<UndoableInsert*>(action)){
+		UndoableInsert* insertAction = static_cast<UndoableInsert*>(action);
+		c.setPosition(insertAction->pos);
+		c.insertText(insertAction->text);
+	}else if(dynamic_cast<UndoableDelete*>(action)){
+		UndoableDelete* deleteAction = static_cast<UndoableDelete*>(action);
 		c.setPosition(deleteAction->start);
 		c.setPosition(deleteAction->end, QTextCursor::KeepAnchor);
 		c.removeSelectedText();
+	}else{
+		UndoableGroup* group = static_cast<UndoableGroup*>(action);
+		for(Action* groupAction : group->actions){
+			redoAction(groupAction, c);
+		}
 	}
-	m_textEdit->setTextCursor(c);
-	emit undoAvailable(!m_undoStack.empty());
-	emit redoAvailable(!m_redoStack.empty());
-	m_actionInProgress = false;
 }
 
 bool UndoRedoStack::insertMergeable(const UndoableInsert* prev, const UndoableInsert* cur) const
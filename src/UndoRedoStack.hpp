@@ -22,6 +22,8 @@
 #include <QObject>
 #include <QStack>
 
+class QTextCursor;
+
 
 namespace QtSpell {
 
@@ -32,8 +34,16 @@ class UndoRedoStack : public QObject
 	Q_OBJECT
 public:
 	UndoRedoStack(TextEditProxy* textEdit);
+	// The history belongs to the document, the widget may change, see TextEditCheckerPrivate::detachDocument
+	void setTextEdit(TextEditProxy* textEdit){ m_textEdit = textEdit; }
+	bool canUndo() const{ return !m_undoStack.isEmpty(); }
+	bool canRedo() const{ return !m_redoStack.isEmpty(); }
 	void handleContentsChange(int pos, int removed, int added);
 	void clear();
+	// Changes recorded between beginGroup and endGroup are undone in one step
+	void beginGroup();
+	void endGroup();
+	qint64 memoryUsage() const;
 
 public slots:
 	void undo();
@@ -47,14 +57,20 @@ private:
 	struct Action;
 	struct UndoableInsert;
 	struct UndoableDelete;
+	struct UndoableGroup;
 
 	bool m_actionInProgress = false;
+	UndoableGroup* m_group = nullptr;
 	TextEditProxy* m_textEdit = nullptr;
 	QStack<Action*> m_undoStack;
 	QStack<Action*> m_redoStack;
 
 	bool insertMergeable(const UndoableInsert* prev, const UndoableInsert* cur) const;
 	bool deleteMergeable(const UndoableDelete* prev, const UndoableDelete* cur) const;
+	void pushAction(Action* action);
+	void undoAction(Action* action, QTextCursor& c);
+	void redoAction(Action* action, QTextCursor& c);
+	qint64 actionMemoryUsage(const Action* action) const;
 };
 
 } // QtSpell